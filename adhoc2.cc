@@ -68,32 +68,30 @@
 #include <vector>
 #include <string>
 
+#include "flow-snapshot.h"
+#include "throughput-series.h"
+#include "flow-rate-estimator.h"
+#include "flow-counters.h"
+#include "batch-traffic-generator.h"
+#include "flow-summary.h"
+#include "mac-trace-counter.h"
+
 using namespace ns3;
 
 int counter = 0;
-int m_sent = 0;
 
 NS_LOG_COMPONENT_DEFINE ("WifiSimpleAdhocGrid");
 
-void MacRxDrop(std::string context, Ptr<const Packet> packet)
-{
-    NS_LOG_UNCOND(context << "at "<<(Simulator::Now()).As(Time::S)
-            <<"has droped a packet as receving");
-}
-
-void MacTxDrop(std::string context, Ptr<const Packet> packet)
+void ThroughputMonitor (FlowMonitorHelper *fmhelper, Ptr<FlowMonitor> flowMon,ThroughputSeries *series,
+                        FlowSnapshotWriter *snapshot, FlowRateEstimator *rates,
+                        FlowCounterTable *counters)
 {
-    NS_LOG_UNCOND(context << "at "<<(Simulator::Now()).As(Time::S)
-            <<"has droped a packet as trasimiting");
-}
-
-void ThroughputMonitor (FlowMonitorHelper *fmhelper, Ptr<FlowMonitor> flowMon,Gnuplot2dDataset DataSet)
-{
-	double localThrou=0;
-	std::map<FlowId, FlowMonitor::FlowStats> flowStats = flowMon->GetFlowStats();
 	Ptr<Ipv4FlowClassifier> classing = DynamicCast<Ipv4FlowClassifier> (fmhelper->GetClassifier());
-	for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator stats = flowStats.begin (); stats != flowStats.end (); ++stats)
+	// one GetFlowStats copy per tick, shared with the snapshot below
+	counters->Update (flowMon);
+	for (FlowCounterTable::Iterator stats = counters->Begin (); stats != counters->End (); ++stats)
 	{
+		FlowId flowId = stats->first;
 		//Ipv4FlowClassifier::FiveTuple fiveTuple = classing->FindFlow (stats->first);
 		//std::cout<<"Flow ID			: " << stats->first <<" ; "<< fiveTuple.sourceAddress <<" -----> "<<fiveTuple.destinationAddress<<std::endl;
 		//std::cout<<"Tx Packets = " << stats->second.txPackets<<std::endl;
@@ -101,18 +99,20 @@ void ThroughputMonitor (FlowMonitorHelper *fmhelper, Ptr<FlowMonitor> flowMon,Gn
 		//std::cout<<"Duration		: "<<(stats->second.timeLastRxPacket.GetSeconds()-stats->second.timeFirstTxPacket.GetSeconds())<<std::endl;
 		//std::cout<<"Last Received Packet	: "<< stats->second.timeLastRxPacket.GetSeconds()<<" Seconds"<<std::endl;
 		//std::cout<<"Throughput: " << stats->second.rxBytes * 8.0 / (stats->second.timeLastRxPacket.GetSeconds()-stats->second.timeFirstTxPacket.GetSeconds())/1024/1024  << " Mbps"<<std::endl;
-		localThrou=(stats->second.rxBytes * 8.0 / (stats->second.timeLastRxPacket.GetSeconds()-stats->second.timeFirstTxPacket.GetSeconds())/1024/1024);
-		// updata gnuplot data
-		DataSet.Add((double)Simulator::Now().GetSeconds(),(double) localThrou);
+		// idle flows are stored at the start and end of the idle period only
+		series->Sample (flowId, stats->second.rxBytes, stats->second.rxPackets);
+		// rates over the last tick only, not since the first packet
+		FlowRate rate = rates->Update (flowId, stats->second);
+		NS_LOG_INFO ("Flow " << flowId << " at " << Simulator::Now ().GetSeconds ()
+		             << "s: throughput " << rate.throughput << " Mbps, goodput " << rate.goodput
+		             << " Mbps, loss " << rate.lossRate);
 		//std::cout<<"---------------------------------------------------------------------------"<<std::endl;
 	}
 	
-	Simulator::Schedule(Seconds(1),&ThroughputMonitor, fmhelper, flowMon,DataSet);
+	Simulator::Schedule(Seconds(1),&ThroughputMonitor, fmhelper, flowMon,series, snapshot, rates, counters);
 	
-	//if(flowToXml)
-	//{
-	flowMon->SerializeToXmlFile ("./scratch/ThroughputMonitor.xml", true, true);
-	//}
+	// append only the flows that changed since the last tick
+	snapshot->Write (counters->GetStats ());
 
 }
 
@@ -125,29 +125,6 @@ void ReceivePacket (Ptr<Socket> socket)
     }
 }
 
-static void GenerateTraffic (Ptr<Socket> socket, uint32_t pktSize, 
-                             uint32_t pktCount, Time pktInterval )
-{
-  SeqTsHeader seqTs;
-  seqTs.SetSeq (m_sent);
-  Ptr<Packet> p = Create<Packet> (pktSize);
-  p->AddHeader (seqTs);
-  
-  if (pktCount > 0)
-    {
-      //socket->Send (Create<Packet> (pktSize));
-      socket->Send (p);
-      ++m_sent;
-      Simulator::Schedule (pktInterval, &GenerateTraffic, 
-                           socket, pktSize,pktCount-1, pktInterval);
-    }
-  else
-    {
-      socket->Close ();
-    }
-}
-
-
 int main (int argc, char *argv[])
 {
   //std::string phyMode ("DsssRate1Mbps");
@@ -159,6 +136,8 @@ int main (int argc, char *argv[])
   double interval = 0.000001; // seconds
   bool verbose = false;
   bool tracing = true;
+  uint32_t rtsCtsThreshold = 2200;
+  std::string summary = ""; // per-flow CSV for sweep.py
 
   CommandLine cmd;
 
@@ -169,8 +148,12 @@ int main (int argc, char *argv[])
   cmd.AddValue ("verbose", "turn on all WifiNetDevice log components", verbose);
   cmd.AddValue ("tracing", "turn on ascii and pcap tracing", tracing);
   cmd.AddValue ("numNodes", "number of nodes", numNodes);
+  cmd.AddValue ("rtsCtsThreshold", "RTS/CTS threshold (bytes)", rtsCtsThreshold);
+  cmd.AddValue ("summary", "write a per-flow CSV summary to this file", summary);
 
   cmd.Parse (argc, argv);
+  // per-run file names under sweep.py, which runs many of us at once
+  std::string output = FlowSummary::OutputPrefix (summary, "./scratch/");
   // Convert to time object
   Time interPacketInterval = Seconds (interval);
   GlobalValue::Bind("ChecksumEnabled", BooleanValue(true));
@@ -181,7 +164,7 @@ int main (int argc, char *argv[])
   // disable fragmentation for frames below 2200 bytes
   //Config::SetDefault ("ns3::WifiRemoteStationManager::FragmentationThreshold", StringValue ("2200"));
   //// turn off RTS/CTS for frames below 2200 bytes
-  //Config::SetDefault ("ns3::WifiRemoteStationManager::RtsCtsThreshold", StringValue ("2200"));
+  //Config::SetDefault ("ns3::WifiRemoteStationManager::RtsCtsThreshold", UintegerValue (rtsCtsThreshold));
   //// Fix non-unicast data rate to be the same as that of unicast
   //Config::SetDefault ("ns3::WifiRemoteStationManager::NonUnicastMode", StringValue (phyMode));
 
@@ -215,7 +198,7 @@ int main (int argc, char *argv[])
   wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
                                 "DataMode",StringValue (phyMode),
                                 "ControlMode",StringValue (phyMode),
-                                "RtsCtsThreshold",UintegerValue(2200),
+                                "RtsCtsThreshold",UintegerValue(rtsCtsThreshold),
                                 "FragmentationThreshold",UintegerValue(2200),
                                 "NonUnicastMode", StringValue(phyMode));
   // Set it to adhoc mode
@@ -279,22 +262,27 @@ int main (int argc, char *argv[])
   if (tracing == true)
     {
       AsciiTraceHelper ascii;
-      wifiPhy.EnableAsciiAll (ascii.CreateFileStream ("./tr/adhoc2.tr"));
+      wifiPhy.EnableAsciiAll (ascii.CreateFileStream (FlowSummary::OutputPrefix (summary, "./tr/") + "adhoc2.tr"));
       //wifiPhy.EnablePcap ("./scratch/adhoc2", devices);
-      wifiPhy.EnablePcap ("./pcap/adhoc2", devices.Get (sourceNode));
-      wifiPhy.EnablePcap ("./pcap/adhoc2", devices.Get (sinkNode));
+      wifiPhy.EnablePcap (FlowSummary::OutputPrefix (summary, "./pcap/") + "adhoc2", devices.Get (sourceNode));
+      wifiPhy.EnablePcap (FlowSummary::OutputPrefix (summary, "./pcap/") + "adhoc2", devices.Get (sinkNode));
       // Trace routing tables
-      Ptr<OutputStreamWrapper> routingStream = Create<OutputStreamWrapper> ("./scratch/adhoc2.routes", std::ios::out);
+      Ptr<OutputStreamWrapper> routingStream = Create<OutputStreamWrapper> (output + "adhoc2.routes", std::ios::out);
       olsr.PrintRoutingTableAllEvery (Seconds (2), routingStream);
-      Ptr<OutputStreamWrapper> neighborStream = Create<OutputStreamWrapper> ("./scratch/adhoc2.neighbors", std::ios::out);
+      Ptr<OutputStreamWrapper> neighborStream = Create<OutputStreamWrapper> (output + "adhoc2.neighbors", std::ios::out);
       olsr.PrintNeighborCacheAllEvery (Seconds (2), neighborStream);
 
       // To do-- enable an IP-level trace that shows forwarding events only
     }
 
-  AnimationInterface anim("xml/adhoc2.xml");
-  anim.UpdateNodeColor(c.Get(sourceNode), 0, 255, 0);
-  anim.UpdateNodeColor(c.Get(sinkNode), 0, 0, 255);
+  // no NetAnim trace for the runs of sweep.py
+  AnimationInterface *anim = 0;
+  if (summary.empty ())
+    {
+      anim = new AnimationInterface ("xml/adhoc2.xml");
+      anim->UpdateNodeColor(c.Get(sourceNode), 0, 255, 0);
+      anim->UpdateNodeColor(c.Get(sinkNode), 0, 0, 255);
+    }
   
   Ptr<Ipv4> ptrIpv4 = c.Get(sourceNode)->GetObject<Ipv4>();
   std::cout<<"source node's address is: "<< ptrIpv4->GetAddress(1,0).GetLocal()<<std::endl;
@@ -313,15 +301,18 @@ int main (int argc, char *argv[])
   //         <<devices.Get(sinkNode)->GetIfIndex()<<std::endl;
 
     // Give OLSR time to converge-- 30 seconds perhaps
-  Simulator::Schedule (Seconds (31.0), &GenerateTraffic, 
-                       source, packetSize, numPackets, interPacketInterval);
+  Ptr<BatchTrafficGenerator> traffic = CreateObject<BatchTrafficGenerator> ();
+  traffic->SetSeqTs (true);
+  traffic->AddSource (source, packetSize, numPackets, interPacketInterval);
+  c.Get (sourceNode)->AddApplication (traffic);
+  traffic->SetStartTime (Seconds (31.0));
 
   // Output what we are doing
   NS_LOG_UNCOND ("Source node is: " << sourceNode << " to sink node: " << sinkNode);
   
   
   // Gnuplot parameters      
-  std::string fileNameWithNoExtension = "./scratch/FlowVSThroughput_";
+  std::string fileNameWithNoExtension = output + "FlowVSThroughput_";
   std::string graphicsFileName        = fileNameWithNoExtension + ".png";
   std::string plotFileName            = fileNameWithNoExtension + ".plt";
   std::string plotTitle               = "Flow vs Throughput";
@@ -336,40 +327,35 @@ int main (int argc, char *argv[])
   gnuplot.SetTerminal ("png");
 
   // Set the labels for each axis.
-  gnuplot.SetLegend ("Flow", "Throughput");
+  gnuplot.SetLegend ("Time (s)", "Throughput (Mbps)");
      
-  Gnuplot2dDataset dataset;
-  dataset.SetTitle (dataTitle);
-  dataset.SetStyle (Gnuplot2dDataset::LINES_POINTS);
+  ThroughputSeries series;
+  series.Open (fileNameWithNoExtension + ".tps");
   
   // Flow monitor
   Ptr<FlowMonitor> flowMonitor;
   FlowMonitorHelper flowHelper;
   flowMonitor = flowHelper.InstallAll();
+  FlowSnapshotWriter snapshot;
+  snapshot.Open (output + "ThroughputMonitor.snap");
+  FlowCounterTable counters;
+  FlowRateEstimator rates (40); // IPv4 + UDP + SeqTsHeader
   
   // call the flow monitor function
-  ThroughputMonitor(&flowHelper, flowMonitor, dataset);
+  ThroughputMonitor(&flowHelper, flowMonitor, &series, &snapshot, &rates, &counters);
 
     //Simulator::Stop (Seconds(4000.0));
   Simulator::Stop (Seconds(50.0)); // for testing/debugging only
 
-  // Trace the source Mac TxDrop 
-  std::ostringstream oss;
-  oss << "/NodeList/" << c.Get(sourceNode)->GetId()<<
-         "/DeviceList/" << devices.Get(sourceNode)->GetIfIndex()<<
-         "/$ns3::WifiNetDevice/Mac";
-  Config::Connect(oss.str(), MakeCallback(&MacTxDrop));
-
-  //Trace the sink Mac RxDrop
-  oss << "/NodeList/" << c.Get(sinkNode)->GetId()<<
-         "/DeviceList/" << devices.Get(sinkNode)->GetIfIndex()<<
-         "/$ns3::WifiNetDevice/Mac";
-  Config::Connect(oss.str(), MakeCallback(&MacRxDrop));
+  // Count MAC tx/rx/drop events per device instead of printing each one
+  MacTraceCounter macCounters;
+  macCounters.Install (devices);
 
   Simulator::Run ();
   
   //Gnuplot ...continued
-  gnuplot.AddDataset (dataset);
+  series.ExportGnuplot (gnuplot, dataTitle);
+  series.ExportCsv (fileNameWithNoExtension + ".csv");
   // Open the plot file.
   std::ofstream plotFile (plotFileName.c_str());
   // Write the plot file.
@@ -391,8 +377,14 @@ int main (int argc, char *argv[])
 	  NS_LOG_UNCOND("Throughput: " << iter->second.rxBytes * 8.0 / (iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds()) / 1024  << " Kbps");
   }       
   */
-  flowMonitor->SerializeToXmlFile("./scratch/adhoc2.xml", true, true);
+  flowMonitor->SerializeToXmlFile(output + "adhoc2.xml", true, true);
+  macCounters.Print (std::cout);
+  if (!summary.empty ())
+    {
+      FlowSummary::Write (flowMonitor, flowHelper, summary);
+    }
 
+  delete anim;
   Simulator::Destroy ();
 
   return 0;
@@ -61,34 +61,37 @@
 #include "ns3/ipv4-list-routing-helper.h"
 #include "ns3/udp-client.h"
 #include "ns3/seq-ts-header.h"
-#include "ns3/netanim-module.h"
 
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <string>
+#include <sstream>
+#include <cmath>
+
+#include "flow-snapshot.h"
+#include "throughput-series.h"
+#include "flow-rate-estimator.h"
+#include "flow-counters.h"
+#include "batch-traffic-generator.h"
+#include "flow-summary.h"
+#include "grid-spectrum-channel.h"
+#include "cached-propagation.h"
+#include "binary-trace.h"
+#include "anim-recorder.h"
+#include "route-journal.h"
+#include "convergence-monitor.h"
+#include "warm-state.h"
+#include "replication-fork.h"
+#include "mac-trace-counter.h"
+#include "seq-ts-sink.h"
 
 using namespace ns3;
 
-int counter = 0;
-int m_sent = 0;
-
 NS_LOG_COMPONENT_DEFINE ("WifiSimpleAdhocGrid");
 
 static bool g_verbose = true;
 
-void MacRxDrop(std::string context, Ptr<const Packet> packet)
-{
-    NS_LOG_UNCOND(context << "at "<<(Simulator::Now()).As(Time::S)
-            <<"has droped a packet as receving");
-}
-
-void MacTxDrop(std::string context, Ptr<const Packet> packet)
-{
-    NS_LOG_UNCOND(context << "at "<<(Simulator::Now()).As(Time::S)
-            <<"has droped a packet as trasimiting");
-}
-
 void MacTxTrace(std::string context, Ptr<const Packet> packet)
 {
     NS_LOG_UNCOND(context << "at "<<(Simulator::Now()).As(Time::S)
@@ -115,13 +118,16 @@ DevRxTrace (std::string context, Ptr<const Packet> p)
     }   
 }
 
-void ThroughputMonitor (FlowMonitorHelper *fmhelper, Ptr<FlowMonitor> flowMon,Gnuplot2dDataset DataSet)
+void ThroughputMonitor (FlowMonitorHelper *fmhelper, Ptr<FlowMonitor> flowMon,ThroughputSeries *series,
+                        FlowSnapshotWriter *snapshot, FlowRateEstimator *rates,
+                        FlowCounterTable *counters)
 {
-	double localThrou=0;
-	std::map<FlowId, FlowMonitor::FlowStats> flowStats = flowMon->GetFlowStats();
 	Ptr<Ipv4FlowClassifier> classing = DynamicCast<Ipv4FlowClassifier> (fmhelper->GetClassifier());
-	for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator stats = flowStats.begin (); stats != flowStats.end (); ++stats)
+	// one GetFlowStats copy per tick, shared with the snapshot below
+	counters->Update (flowMon);
+	for (FlowCounterTable::Iterator stats = counters->Begin (); stats != counters->End (); ++stats)
 	{
+		FlowId flowId = stats->first;
 		//Ipv4FlowClassifier::FiveTuple fiveTuple = classing->FindFlow (stats->first);
 		//std::cout<<"Flow ID			: " << stats->first <<" ; "<< fiveTuple.sourceAddress <<" -----> "<<fiveTuple.destinationAddress<<std::endl;
 		//std::cout<<"Tx Packets = " << stats->second.txPackets<<std::endl;
@@ -129,53 +135,39 @@ void ThroughputMonitor (FlowMonitorHelper *fmhelper, Ptr<FlowMonitor> flowMon,Gn
 		//std::cout<<"Duration		: "<<(stats->second.timeLastRxPacket.GetSeconds()-stats->second.timeFirstTxPacket.GetSeconds())<<std::endl;
 		//std::cout<<"Last Received Packet	: "<< stats->second.timeLastRxPacket.GetSeconds()<<" Seconds"<<std::endl;
 		//std::cout<<"Throughput: " << stats->second.rxBytes * 8.0 / (stats->second.timeLastRxPacket.GetSeconds()-stats->second.timeFirstTxPacket.GetSeconds())/1024/1024  << " Mbps"<<std::endl;
-		localThrou=(stats->second.rxBytes * 8.0 / (stats->second.timeLastRxPacket.GetSeconds()-stats->second.timeFirstTxPacket.GetSeconds())/1024/1024);
-		// updata gnuplot data
-		DataSet.Add((double)Simulator::Now().GetSeconds(),(double) localThrou);
+		// idle flows are stored at the start and end of the idle period only
+		series->Sample (flowId, stats->second.rxBytes, stats->second.rxPackets);
+		// rates over the last tick only, not since the first packet
+		FlowRate rate = rates->Update (flowId, stats->second);
+		NS_LOG_INFO ("Flow " << flowId << " at " << Simulator::Now ().GetSeconds ()
+		             << "s: throughput " << rate.throughput << " Mbps, goodput " << rate.goodput
+		             << " Mbps, loss " << rate.lossRate);
 		//std::cout<<"---------------------------------------------------------------------------"<<std::endl;
 	}
 	
-	Simulator::Schedule(Seconds(1),&ThroughputMonitor, fmhelper, flowMon,DataSet);
+	Simulator::Schedule(Seconds(1),&ThroughputMonitor, fmhelper, flowMon,series, snapshot, rates, counters);
 	
-	//if(flowToXml)
-	//{
-	flowMon->SerializeToXmlFile ("./scratch/ThroughputMonitor.xml", true, true);
-	//}
+	// append only the flows that changed since the last tick
+	snapshot->Write (counters->GetStats ());
 
 }
 
-void ReceivePacket (Ptr<Socket> socket)
-{
-  while (socket->Recv ())
-    {
-      //NS_LOG_UNCOND ("Received one packet!");
-      std::cout << Simulator::Now().GetSeconds() << " Received packet: " << ++counter << std::endl;
-    }
-}
+// warm state file written when the traffic starts, if any
+static std::string g_saveWarm;
 
-static void GenerateTraffic (Ptr<Socket> socket, uint32_t pktSize, 
-                             uint32_t pktCount, Time pktInterval, uint8_t const *buffer )
+// Start the traffic once the routes have converged, keeping the time the
+// run had after the fixed start
+void StartTraffic (Ptr<BatchTrafficGenerator> traffic, Time tail)
 {
-  SeqTsHeader seqTs;
-  seqTs.SetSeq (m_sent);
-  Ptr<Packet> p = Create<Packet> (buffer, pktSize);
-  p->AddHeader (seqTs);
-  
-  if (pktCount > 0)
-    {
-      //socket->Send (Create<Packet> (pktSize));
-      socket->Send (p);
-      ++m_sent;
-      Simulator::Schedule (pktInterval, &GenerateTraffic, 
-                           socket, pktSize,pktCount-1, pktInterval, buffer );
-    }
-  else
+  NS_LOG_UNCOND ("Routes converged at " << Simulator::Now ().GetSeconds () << " s");
+  if (!g_saveWarm.empty ())
     {
-      socket->Close ();
+      WarmState::Save (g_saveWarm, NodeContainer::GetGlobal ());
     }
+  traffic->StartNow ();
+  Simulator::Stop (tail);
 }
 
-
 int main (int argc, char *argv[])
 {
   //std::string phyMode ("DsssRate1Mbps");
@@ -187,6 +179,16 @@ int main (int argc, char *argv[])
   double interval = 0.1; // seconds
   bool verbose = false;
   bool tracing = true;
+  uint32_t rtsCtsThreshold = 2200;
+  std::string summary = ""; // per-flow CSV for sweep.py
+  bool spatialChannel = false; // cull far receivers on a GridSpectrumChannel
+  bool cachePropagation = false; // look loss and delay up per node pair
+  double convergence = 6;  // s of stable routes before the traffic, 0 for a fixed start
+  std::string loadWarm = ""; // routes and neighbors to preload instead of warming up
+  uint32_t replications = 1; // runs forked from one built topology
+  uint32_t workers = 0;  // replications running at once, 0 for one per CPU
+  uint32_t gridWidth = 5;  // nodes per grid row, 0 for a square grid
+  double animStop = 0;  // seconds of packets in the animation, 0 for all
 
   CommandLine cmd;
 
@@ -197,8 +199,21 @@ int main (int argc, char *argv[])
   cmd.AddValue ("verbose", "turn on all WifiNetDevice log components", verbose);
   cmd.AddValue ("tracing", "turn on ascii and pcap tracing", tracing);
   cmd.AddValue ("numNodes", "number of nodes", numNodes);
+  cmd.AddValue ("rtsCtsThreshold", "RTS/CTS threshold (bytes)", rtsCtsThreshold);
+  cmd.AddValue ("summary", "write a per-flow CSV summary to this file", summary);
+  cmd.AddValue ("cachePropagation", "cache the Friis loss and the delay of every node pair instead of computing them per frame", cachePropagation);
+  cmd.AddValue ("spatialChannel", "use SpectrumWifiPhy on a GridSpectrumChannel that skips receivers below the ED threshold", spatialChannel);
+  cmd.AddValue ("convergence", "start the traffic after the routes are stable for this many seconds, 31 s at the latest (0: at 31 s)", convergence);
+  cmd.AddValue ("saveWarm", "save the routes and neighbors to this file when the traffic starts", g_saveWarm);
+  cmd.AddValue ("loadWarm", "preload the routes and neighbors saved by --saveWarm and start the traffic at 1 s", loadWarm);
+  cmd.AddValue ("replications", "fork this many runs, from RngRun on, after building the topology", replications);
+  cmd.AddValue ("workers", "replications running at once (0: one per CPU)", workers);
+  cmd.AddValue ("gridWidth", "nodes per grid row (0: square grid)", gridWidth);
+  cmd.AddValue ("animStop", "stop recording packets for the animation after this many seconds (0: never)", animStop);
 
   cmd.Parse (argc, argv);
+  // per-run file names under sweep.py, which runs many of us at once
+  std::string output = FlowSummary::OutputPrefix (summary, "./scratch/");
   // Convert to time object
   Time interPacketInterval = Seconds (interval);
   GlobalValue::Bind("ChecksumEnabled", BooleanValue(true));
@@ -209,7 +224,7 @@ int main (int argc, char *argv[])
   // disable fragmentation for frames below 2200 bytes
   //Config::SetDefault ("ns3::WifiRemoteStationManager::FragmentationThreshold", StringValue ("2200"));
   //// turn off RTS/CTS for frames below 2200 bytes
-  //Config::SetDefault ("ns3::WifiRemoteStationManager::RtsCtsThreshold", StringValue ("2200"));
+  //Config::SetDefault ("ns3::WifiRemoteStationManager::RtsCtsThreshold", UintegerValue (rtsCtsThreshold));
   //// Fix non-unicast data rate to be the same as that of unicast
   //Config::SetDefault ("ns3::WifiRemoteStationManager::NonUnicastMode", StringValue (phyMode));
 
@@ -235,7 +250,42 @@ int main (int argc, char *argv[])
   YansWifiChannelHelper wifiChannel;
   wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
   wifiChannel.AddPropagationLoss ("ns3::FriisPropagationLossModel");
-  wifiPhy.SetChannel (wifiChannel.Create ());
+  Ptr<YansWifiChannel> yansChannel = wifiChannel.Create ();
+  // the grid is static: loss and delay can be computed once per node pair
+  Ptr<CachedPropagationLossModel> cachedLoss;
+  Ptr<CachedPropagationDelayModel> cachedDelay;
+  if (cachePropagation)
+    {
+      cachedLoss = CreateObject<CachedPropagationLossModel> ();
+      cachedLoss->SetModel (CreateObject<FriisPropagationLossModel> ());
+      yansChannel->SetPropagationLossModel (cachedLoss);
+      cachedDelay = CreateObject<CachedPropagationDelayModel> ();
+      cachedDelay->SetModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+      yansChannel->SetPropagationDelayModel (cachedDelay);
+    }
+  wifiPhy.SetChannel (yansChannel);
+
+  // Same PHY on a spectrum channel that only schedules receptions for
+  // nodes within reach: path loss more than 10 dB above what the ED
+  // threshold allows (TxPower + TxGain + RxGain - EnergyDetectionThreshold,
+  // the gains being WifiPhy's 1 dB defaults) is culled, and far cells of
+  // the grid are never visited.  Culled signals add no interference, see
+  // grid-spectrum-channel.h.
+  SpectrumWifiPhyHelper spectrumPhy = SpectrumWifiPhyHelper::Default ();
+  if (spatialChannel)
+    {
+      spectrumPhy.Set("TxPowerStart", DoubleValue(5));
+      spectrumPhy.Set("TxPowerEnd", DoubleValue(5));
+      spectrumPhy.Set("EnergyDetectionThreshold", DoubleValue(-83.0) );
+      Ptr<GridSpectrumChannel> gridChannel = CreateObject<GridSpectrumChannel> ();
+      gridChannel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+      gridChannel->AddPropagationLossModel (CreateObject<FriisPropagationLossModel> ());
+      gridChannel->SetAttribute ("MaxLossDb", DoubleValue (GridSpectrumChannel::GetMaxLossDb (5, 1, 1, -83.0, 10)));
+      spectrumPhy.SetChannel (gridChannel);
+    }
+
+  WifiPhyHelper &phy = spatialChannel ? static_cast<WifiPhyHelper &> (spectrumPhy)
+                                      : static_cast<WifiPhyHelper &> (wifiPhy);
 
   // Add a non-QoS upper mac, and disable rate control
   NqosWifiMacHelper wifiMac = NqosWifiMacHelper::Default ();
@@ -243,12 +293,17 @@ int main (int argc, char *argv[])
   wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
                                 "DataMode",StringValue (phyMode),
                                 "ControlMode",StringValue (phyMode),
-                                "RtsCtsThreshold",UintegerValue(2200),
+                                "RtsCtsThreshold",UintegerValue(rtsCtsThreshold),
                                 "FragmentationThreshold",UintegerValue(2200),
                                 "NonUnicastMode", StringValue(phyMode));
   // Set it to adhoc mode
   wifiMac.SetType ("ns3::AdhocWifiMac");
-  NetDeviceContainer devices = wifi.Install (wifiPhy, wifiMac, c);
+  NetDeviceContainer devices = wifi.Install (phy, wifiMac, c);
+
+  if (gridWidth == 0)
+    {
+      gridWidth = static_cast<uint32_t> (std::ceil (std::sqrt (numNodes)));
+    }
 
   MobilityHelper mobility;
   mobility.SetPositionAllocator("ns3::GridPositionAllocator",
@@ -256,7 +311,7 @@ int main (int argc, char *argv[])
             "MinY", DoubleValue(0),
             "DeltaX", DoubleValue(30),
             "DeltaY", DoubleValue(30),
-            "GridWidth", UintegerValue(5),
+            "GridWidth", UintegerValue(gridWidth),
             "LayoutType", StringValue("RowFirst")
             );
   mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
@@ -276,6 +331,11 @@ int main (int argc, char *argv[])
   //                           "Bounds", StringValue ("0|500|0|500"));
   
   mobility.Install (c);
+  if (cachePropagation)
+    {
+      cachedLoss->Precompute (c);
+      cachedDelay->Precompute (c);
+    }
 
   // Enable OLSR
   OlsrHelper olsr;
@@ -291,36 +351,83 @@ int main (int argc, char *argv[])
 
   Ipv4AddressHelper ipv4;
   NS_LOG_INFO ("Assign IP Addresses.");
-  ipv4.SetBase ("192.168.1.0", "255.255.255.0");
+  // a /24 holds 254 hosts; larger grids get a /16 with the same first addresses
+  if (numNodes > 254)
+    {
+      ipv4.SetBase ("192.168.0.0", "255.255.0.0", "0.0.1.1");
+    }
+  else
+    {
+      ipv4.SetBase ("192.168.1.0", "255.255.255.0");
+    }
   Ipv4InterfaceContainer i = ipv4.Assign (devices);
 
   TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
-  Ptr<Socket> recvSink = Socket::CreateSocket (c.Get (sinkNode), tid);
-  InetSocketAddress local = InetSocketAddress (Ipv4Address::GetAny (), 80);
-  recvSink->Bind (local);
-  recvSink->SetRecvCallback (MakeCallback (&ReceivePacket));
+  // account loss, reordering and delay from the SeqTsHeader of each packet
+  Ptr<SeqTsSink> recvSink = CreateObject<SeqTsSink> ();
+  recvSink->SetAttribute ("Local", AddressValue (InetSocketAddress (Ipv4Address::GetAny (), 80)));
+  c.Get (sinkNode)->AddApplication (recvSink);
+  recvSink->SetStartTime (Seconds (0.0));
 
   Ptr<Socket> source = Socket::CreateSocket (c.Get (sourceNode), tid);
   InetSocketAddress remote = InetSocketAddress (i.GetAddress (sinkNode, 0), 80);
   source->Connect (remote);
 
+  // The topology is built; fork the replications from here.  A worker
+  // reseeds the streams drawn before the fork and writes its own files.
+  ReplicationFork replicationFork;
+  replicationFork.SetReplications (replications);
+  replicationFork.SetWorkers (workers);
+  if (!replicationFork.Start ())
+    {
+      replicationFork.Print (std::cout);
+      if (!summary.empty ())
+        {
+          replicationFork.Write (summary);
+        }
+      Simulator::Destroy ();
+      return replicationFork.GetFailed () > 0 ? 1 : 0;
+    }
+  std::string runSuffix = "";
+  if (replicationFork.IsWorker ())
+    {
+      int64_t stream = 1;
+      stream += wifi.AssignStreams (devices, stream);
+      stream += internet.AssignStreams (c, stream);
+      olsr.AssignStreams (c, stream);
+      std::ostringstream oss;
+      oss << "-run" << replicationFork.GetRun ();
+      runSuffix = oss.str ();
+      // the trace writer thread does not survive fork (), and all the
+      // workers would share the trace files
+      tracing = false;
+    }
+
+  // PHY events of all devices go to one binary file written by a separate
+  // thread; "btrace.py ascii" rebuilds myManet.tr and "btrace.py pcap
+  // --nodes=<source>,<sink>" the pcap/adhoc3-*.pcap files
+  BinaryTraceWriter binaryTrace;
+  RouteJournal journal;
   if (tracing == true)
     {
-      AsciiTraceHelper ascii;
-      wifiPhy.EnableAsciiAll (ascii.CreateFileStream ("./scratch/myManet.tr"));
+      binaryTrace.Open (output + "myManet.btr.gz");
+      binaryTrace.EnableWifi (devices);
       //wifiPhy.EnablePcap ("./scratch/myManet", devices);
-      wifiPhy.EnablePcap ("./pcap/adhoc3", devices.Get (sourceNode));
-      wifiPhy.EnablePcap ("./pcap/adhoc3", devices.Get (sinkNode));
-      // Trace routing tables
-      Ptr<OutputStreamWrapper> routingStream = Create<OutputStreamWrapper> ("./scratch/myManet.routes", std::ios::out);
-      olsr.PrintRoutingTableAllEvery (Seconds (2), routingStream);
-      Ptr<OutputStreamWrapper> neighborStream = Create<OutputStreamWrapper> ("./scratch/myManet.neighbors", std::ios::out);
-      olsr.PrintNeighborCacheAllEvery (Seconds (2), neighborStream);
+      // Journal routing table and neighbor cache changes; "routes.py table
+      // ./scratch/myManet.journal <node> <time>" rebuilds a node's table
+      journal.Open (output + "myManet.journal");
+      journal.EnableOlsr (c);
+      journal.EnableNeighbors (c, Seconds (2));
 
       // To do-- enable an IP-level trace that shows forwarding events only
     }
 
-  AnimationInterface anim("xml/adhoc3.xml");
+  // python scratch/anim2xml.py xml/adhoc3.anim xml/adhoc3.xml for NetAnim
+  AnimRecorder anim (FlowSummary::OutputPrefix (summary, "xml/") + "adhoc3" + runSuffix + ".anim");
+  if (animStop > 0)
+    {
+      anim.SetStopTime (Seconds (animStop));
+    }
   anim.UpdateNodeColor(c.Get(sourceNode), 0, 255, 0);
   anim.UpdateNodeColor(c.Get(sinkNode), 255, 0, 0);
   
@@ -334,38 +441,12 @@ int main (int argc, char *argv[])
   //    std::cout<<"node "<<i<<" address is: "<< ptrIpv4->GetAddress(1,0).GetLocal()<<std::endl;
   //}
 
-  //The max num can't great than 127, uint8_t type's variable means a 8 bits value, 
-  //which means that the variable of this type only can indicate 127 ascii characters
-  uint8_t *ptr = new uint8_t[packetSize];
-  // The array is the string "Hello world! " in ascii character.
-  int array[] = {72, 101, 108, 108, 111, 32, 119, 111, 114, 108, 100, 33, 32};
-  uint8_t const *ptrdata = NULL;
-  for(int i = 0; i < packetSize; i++){
-      ptr[i] = array[i%13];
-  }
-  ptrdata = ptr;
-
-  //for(int i = 0; i < packetSize; i++){
-  //    std::cout<<ptr[i]<<" ";
-  //}
-  //std::cout<<std::endl;
   //Config::Connect ("/NodeList/26/DeviceList/0/Mac/MacTx", MakeCallback (&DevTxTrace));
   //Config::Connect ("/NodeList/26/DeviceList/0/Mac/MacRx", MakeCallback (&DevRxTrace));
 
-  // Trace the source Mac TxDrop 
-  std::ostringstream oss;
-  oss << "/NodeList/" << c.Get(sourceNode)->GetId()<<
-         "/DeviceList/" << devices.Get(sourceNode)->GetIfIndex()<<
-         "/$ns3::WifiNetDevice/Mac/MacTxDrop";
-  Config::Connect(oss.str(), MakeCallback(&MacTxDrop));
-
-  //Trace the sink Mac RxDrop
-  oss.clear();//clear the error state 
-  oss.str("");//clear the contents
-  oss << "/NodeList/" << c.Get(sinkNode)->GetId()<<
-         "/DeviceList/" << devices.Get(sinkNode)->GetIfIndex()<<
-         "/$ns3::WifiNetDevice/Mac/MacRxDrop";
-  Config::Connect(oss.str(), MakeCallback(&MacRxDrop));
+  // Count MAC tx/rx/drop events per device instead of printing each one
+  MacTraceCounter macCounters;
+  macCounters.Install (devices);
 
   //Trace the tx event
   //oss.clear();
@@ -376,15 +457,42 @@ int main (int argc, char *argv[])
   //Config::Connect(oss.str(), MakeCallback(&MacTxTrace));
 
   // Give OLSR time to converge-- 30 seconds perhaps
-  Simulator::Schedule (Seconds (31.0), &GenerateTraffic, 
-                       source, packetSize, numPackets, interPacketInterval, ptrdata);
+  Ptr<BatchTrafficGenerator> traffic = CreateObject<BatchTrafficGenerator> ();
+  traffic->SetSeqTs (true);
+  // Nothing reads the payload, so leave it zero-filled: a Buffer zero area
+  // costs nothing per packet, where a "Hello world! " pattern would be
+  // memcpy'd into every packet once the SeqTs header goes on.
+  traffic->AddSource (source, packetSize, numPackets, interPacketInterval);
+  c.Get (sourceNode)->AddApplication (traffic);
+  traffic->SetStartTime (Seconds (31.0));
+  // Start as soon as every node has a route to every other one, and the
+  // tables have not moved for 'convergence' seconds
+  ConvergenceMonitor convergenceMonitor;
+  if (!loadWarm.empty ())
+    {
+      // no warm-up: OLSR converges in the background behind the saved routes
+      WarmState::Load (loadWarm);
+      traffic->SetStartTime (Seconds (1.0));
+      Simulator::Stop (Seconds (1.0 + 50.0 - 31.0));
+    }
+  else if (convergence > 0)
+    {
+      convergenceMonitor.SetWindow (Seconds (convergence));
+      convergenceMonitor.SetMinRoutes (numNodes - 1);
+      convergenceMonitor.SetTimeout (Seconds (31.0));
+      convergenceMonitor.Install (c, MakeBoundCallback (&StartTraffic, traffic, Seconds (50.0 - 31.0)));
+    }
+  else if (!g_saveWarm.empty ())
+    {
+      Simulator::Schedule (Seconds (31.0), &WarmState::Save, g_saveWarm, c);
+    }
 
   // Output what we are doing
   NS_LOG_UNCOND ("Source node is: " << sourceNode << " to sink node: " << sinkNode);
   
   
   // Gnuplot parameters      
-  std::string fileNameWithNoExtension = "./scratch/FlowVSThroughput_";
+  std::string fileNameWithNoExtension = output + "FlowVSThroughput" + runSuffix + "_";
   std::string graphicsFileName        = fileNameWithNoExtension + ".png";
   std::string plotFileName            = fileNameWithNoExtension + ".plt";
   std::string plotTitle               = "Flow vs Throughput";
@@ -399,26 +507,41 @@ int main (int argc, char *argv[])
   gnuplot.SetTerminal ("png");
 
   // Set the labels for each axis.
-  gnuplot.SetLegend ("Flow", "Throughput");
+  gnuplot.SetLegend ("Time (s)", "Throughput (Mbps)");
      
-  Gnuplot2dDataset dataset;
-  dataset.SetTitle (dataTitle);
-  dataset.SetStyle (Gnuplot2dDataset::LINES_POINTS);
+  ThroughputSeries series;
+  series.Open (fileNameWithNoExtension + ".tps");
   
   // Flow monitor
   Ptr<FlowMonitor> flowMonitor;
   FlowMonitorHelper flowHelper;
   flowMonitor = flowHelper.InstallAll();
+  FlowSnapshotWriter snapshot;
+  snapshot.Open (output + "ThroughputMonitor" + runSuffix + ".snap");
+  FlowCounterTable counters;
+  FlowRateEstimator rates (40); // IPv4 + UDP + SeqTsHeader
   
   // call the flow monitor function
-  ThroughputMonitor(&flowHelper, flowMonitor, dataset);
+  ThroughputMonitor(&flowHelper, flowMonitor, &series, &snapshot, &rates, &counters);
 
   //Simulator::Stop (Seconds(4000.0));
   Simulator::Stop (Seconds(50.0)); // for testing/debugging only
   Simulator::Run ();
+  // a worker sends its flow summary to the parent and exits here, without
+  // destructors: finish its own files first
+  if (replicationFork.IsWorker ())
+    {
+      anim.Close ();
+      series.Close ();
+      snapshot.Close ();
+    }
+  replicationFork.Report (flowMonitor, flowHelper);
+  binaryTrace.Close ();
+  journal.Close ();
   
   //Gnuplot ...continued
-  gnuplot.AddDataset (dataset);
+  series.ExportGnuplot (gnuplot, dataTitle);
+  series.ExportCsv (fileNameWithNoExtension + ".csv");
   // Open the plot file.
   std::ofstream plotFile (plotFileName.c_str());
   // Write the plot file.
@@ -440,10 +563,15 @@ int main (int argc, char *argv[])
 	  NS_LOG_UNCOND("Throughput: " << iter->second.rxBytes * 8.0 / (iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds()) / 1024  << " Kbps");
   }       
   */
-  flowMonitor->SerializeToXmlFile("./scratch/myManet.xml", true, true);
+  flowMonitor->SerializeToXmlFile(output + "myManet.xml", true, true);
+  macCounters.Print (std::cout);
+  recvSink->Print (std::cout);
+  if (!summary.empty ())
+    {
+      FlowSummary::Write (flowMonitor, flowHelper, summary);
+    }
 
   Simulator::Destroy ();
-  delete [] ptrdata;
 
   return 0;
 }
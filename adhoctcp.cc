@@ -22,6 +22,11 @@
 #include <vector>
 #include <string>
 
+#include "flow-snapshot.h"
+#include "throughput-series.h"
+#include "flow-rate-estimator.h"
+#include "flow-counters.h"
+
 //Network topology
 //
 //   S     *     *     *     *
@@ -46,13 +51,16 @@ int m_sent = 0;
 
 NS_LOG_COMPONENT_DEFINE("SimpleWirelessTcp");
 
-void ThroughputMonitor (FlowMonitorHelper *fmhelper, Ptr<FlowMonitor> flowMon,Gnuplot2dDataset DataSet)
+void ThroughputMonitor (FlowMonitorHelper *fmhelper, Ptr<FlowMonitor> flowMon,ThroughputSeries *series,
+                        FlowSnapshotWriter *snapshot, FlowRateEstimator *rates,
+                        FlowCounterTable *counters)
 {
-	double localThrou=0;
-	std::map<FlowId, FlowMonitor::FlowStats> flowStats = flowMon->GetFlowStats();
 	Ptr<Ipv4FlowClassifier> classing = DynamicCast<Ipv4FlowClassifier> (fmhelper->GetClassifier());
-	for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator stats = flowStats.begin (); stats != flowStats.end (); ++stats)
+	// one GetFlowStats copy per tick, shared with the snapshot below
+	counters->Update (flowMon);
+	for (FlowCounterTable::Iterator stats = counters->Begin (); stats != counters->End (); ++stats)
 	{
+		FlowId flowId = stats->first;
 		//Ipv4FlowClassifier::FiveTuple fiveTuple = classing->FindFlow (stats->first);
 		//std::cout<<"Flow ID			: " << stats->first <<" ; "<< fiveTuple.sourceAddress <<" -----> "<<fiveTuple.destinationAddress<<std::endl;
 		//std::cout<<"Tx Packets = " << stats->second.txPackets<<std::endl;
@@ -60,18 +68,20 @@ void ThroughputMonitor (FlowMonitorHelper *fmhelper, Ptr<FlowMonitor> flowMon,Gn
 		//std::cout<<"Duration		: "<<(stats->second.timeLastRxPacket.GetSeconds()-stats->second.timeFirstTxPacket.GetSeconds())<<std::endl;
 		//std::cout<<"Last Received Packet	: "<< stats->second.timeLastRxPacket.GetSeconds()<<" Seconds"<<std::endl;
 		//std::cout<<"Throughput: " << stats->second.rxBytes * 8.0 / (stats->second.timeLastRxPacket.GetSeconds()-stats->second.timeFirstTxPacket.GetSeconds())/1024/1024  << " Mbps"<<std::endl;
-		localThrou=(stats->second.rxBytes * 8.0 / (stats->second.timeLastRxPacket.GetSeconds()-stats->second.timeFirstTxPacket.GetSeconds())/1024/1024);
-		// updata gnuplot data
-		DataSet.Add((double)Simulator::Now().GetSeconds(),(double) localThrou);
+		// idle flows are stored at the start and end of the idle period only
+		series->Sample (flowId, stats->second.rxBytes, stats->second.rxPackets);
+		// rates over the last tick only, not since the first packet
+		FlowRate rate = rates->Update (flowId, stats->second);
+		NS_LOG_INFO ("Flow " << flowId << " at " << Simulator::Now ().GetSeconds ()
+		             << "s: throughput " << rate.throughput << " Mbps, goodput " << rate.goodput
+		             << " Mbps, loss " << rate.lossRate);
 		//std::cout<<"---------------------------------------------------------------------------"<<std::endl;
 	}
 	
-	Simulator::Schedule(Seconds(1),&ThroughputMonitor, fmhelper, flowMon,DataSet);
+	Simulator::Schedule(Seconds(1),&ThroughputMonitor, fmhelper, flowMon,series, snapshot, rates, counters);
 	
-	//if(flowToXml)
-	//{
-	flowMon->SerializeToXmlFile ("./adhoctcp/ThroughputMonitor.xml", true, true);
-	//}
+	// append only the flows that changed since the last tick
+	snapshot->Write (counters->GetStats ());
 
 }
 
@@ -309,26 +319,30 @@ int main(int argc, char* argv[])
   gnuplot.SetTerminal ("png");
 
   // Set the labels for each axis.
-  gnuplot.SetLegend ("Flow", "Throughput");
+  gnuplot.SetLegend ("Time (s)", "Throughput (Mbps)");
      
-  Gnuplot2dDataset dataset;
-  dataset.SetTitle (dataTitle);
-  dataset.SetStyle (Gnuplot2dDataset::LINES_POINTS);
+  ThroughputSeries series;
+  series.Open (fileNameWithNoExtension + ".tps");
   
   // Flow monitor
   Ptr<FlowMonitor> flowMonitor;
   FlowMonitorHelper flowHelper;
   flowMonitor = flowHelper.InstallAll();
+  FlowSnapshotWriter snapshot;
+  snapshot.Open ("./adhoctcp/ThroughputMonitor.snap");
+  FlowCounterTable counters;
+  FlowRateEstimator rates (40); // IPv4 + UDP + SeqTsHeader
   
   // call the flow monitor function
-  ThroughputMonitor(&flowHelper, flowMonitor, dataset);
+  ThroughputMonitor(&flowHelper, flowMonitor, &series, &snapshot, &rates, &counters);
 
   //Simulator::Stop (Seconds(4000.0));
   Simulator::Stop (Seconds(50.0)); // for testing/debugging only
   Simulator::Run ();
   
   //Gnuplot ...continued
-  gnuplot.AddDataset (dataset);
+  series.ExportGnuplot (gnuplot, dataTitle);
+  series.ExportCsv (fileNameWithNoExtension + ".csv");
   // Open the plot file.
   std::ofstream plotFile (plotFileName.c_str());
   // Write the plot file.
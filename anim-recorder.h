@@ -0,0 +1,438 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Compact animation recorder, converted to NetAnim XML afterwards.
+ *
+ * AnimationInterface formats an XML element for every packet of every
+ * device for the whole run, polls every node's position, and prints the
+ * packet metadata when it is enabled.  AnimRecorder takes the same calls
+ * the scripts make (UpdateNodeColor, UpdateNodeSize, SetConstantPosition)
+ * and writes binary records instead:
+ *
+ *   positions  written on CourseChange only, at most one per node per
+ *              SetPositionInterval (a move held back is written when
+ *              the interval is over)
+ *   packets    first bit sent (PhyTxBegin) and last bit received
+ *              (PhyRxEnd) of wifi, CSMA and point-to-point devices, only
+ *              inside [SetStartTime, SetStopTime), and only for 1 packet
+ *              uid in SetPacketSampling; EnablePacketTracing (false)
+ *              leaves the nodes and their moves alone
+ *   metadata   off unless EnablePacketMetadata (true), which also turns
+ *              on Packet::EnablePrinting
+ *
+ * anim2xml.py turns the file into a NetAnim (netanim-3.107) XML file.
+ *
+ * File layout, little-endian:
+ *   header  "NS3ANI01", uint32 version (1), uint32 0
+ *   record  uint8 type, uint8 link, 2 bytes padding, uint32 nodeId,
+ *           uint64 time (ns), then by type; link is 1 for the TX and RX
+ *           of CSMA and point-to-point devices, 0 otherwise
+ *   type    0 NODE   double x, double y          (node at Install)
+ *           1 MOVE   double x, double y
+ *           2 COLOR  uint8 r, g, b, 1 byte padding
+ *           3 SIZE   double width, double height
+ *           4 DESCR  uint32 length, then the text
+ *           5 TX     uint64 uid, uint32 size, uint32 length, then the
+ *                    metadata text (empty unless enabled)
+ *           6 RX     uint64 uid
+ *
+ * Usage, in place of AnimationInterface:
+ *   AnimRecorder anim ("xml/adhoc3.anim");
+ *   anim.UpdateNodeColor (c.Get (sourceNode), 0, 255, 0);
+ *   anim.SetStopTime (Seconds (5));
+ *   ...
+ *   python scratch/anim2xml.py xml/adhoc3.anim xml/adhoc3.xml
+ */
+
+#ifndef ANIM_RECORDER_H
+#define ANIM_RECORDER_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include "trace-binder.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+class AnimRecorder
+{
+public:
+  enum Record
+  {
+    NODE,
+    MOVE,
+    COLOR,
+    SIZE,
+    DESCR,
+    TX,
+    RX
+  };
+
+  // Open 'fileName' and install on every node that exists now.
+  AnimRecorder (std::string fileName)
+    : m_start (Seconds (0)),
+      m_stop (Time::Max ()),
+      m_positionInterval (Seconds (0)),
+      m_sampling (1),
+      m_packets (true),
+      m_metadata (false)
+  {
+    m_file.open (fileName.c_str (), std::ios::out | std::ios::binary);
+    NS_ABORT_MSG_UNLESS (m_file.is_open (), "Can't open " << fileName);
+    m_file.write ("NS3ANI01", 8);
+    Put32 (1);
+    Put32 (0);
+    for (NodeList::Iterator n = NodeList::Begin (); n != NodeList::End (); ++n)
+      {
+        Install (*n);
+      }
+  }
+
+  ~AnimRecorder ()
+  {
+    Close ();
+  }
+
+  // Packets before 'start' are not recorded.
+  void SetStartTime (Time start)
+  {
+    m_start = start;
+  }
+
+  // Packets from 'stop' on are not recorded.
+  void SetStopTime (Time stop)
+  {
+    m_stop = stop;
+  }
+
+  // At most one position per node per 'interval'; 0 keeps every move.
+  void SetPositionInterval (Time interval)
+  {
+    m_positionInterval = interval;
+  }
+
+  // Record the packets whose uid is a multiple of 'n'.
+  void SetPacketSampling (uint32_t n)
+  {
+    NS_ABORT_MSG_UNLESS (n > 0, "Packet sampling must be at least 1");
+    m_sampling = n;
+  }
+
+  void EnablePacketTracing (bool enable)
+  {
+    m_packets = enable;
+  }
+
+  // Must be called before the packets to describe are created.
+  void EnablePacketMetadata (bool enable)
+  {
+    m_metadata = enable;
+    if (enable)
+      {
+        Packet::EnablePrinting ();
+      }
+  }
+
+  void UpdateNodeColor (Ptr<Node> node, uint8_t r, uint8_t g, uint8_t b)
+  {
+    UpdateNodeColor (node->GetId (), r, g, b);
+  }
+
+  void UpdateNodeColor (uint32_t nodeId, uint8_t r, uint8_t g, uint8_t b)
+  {
+    PutHeader (COLOR, nodeId);
+    m_file.put (r);
+    m_file.put (g);
+    m_file.put (b);
+    m_file.put (0);
+  }
+
+  void UpdateNodeSize (uint32_t nodeId, double width, double height)
+  {
+    PutHeader (SIZE, nodeId);
+    PutDouble (width);
+    PutDouble (height);
+  }
+
+  void UpdateNodeDescription (Ptr<Node> node, std::string description)
+  {
+    PutHeader (DESCR, node->GetId ());
+    Put32 (description.size ());
+    m_file.write (description.data (), description.size ());
+  }
+
+  /*
+   * Place a node, as AnimationInterface::SetConstantPosition: a node
+   * without a mobility model gets a ConstantPositionMobilityModel.
+   */
+  void SetConstantPosition (Ptr<Node> node, double x, double y, double z = 0)
+  {
+    Ptr<MobilityModel> mobility = node->GetObject<MobilityModel> ();
+    if (mobility != 0)
+      {
+        // recorded through CourseChange
+        mobility->SetPosition (Vector (x, y, z));
+        return;
+      }
+    mobility = CreateObject<ConstantPositionMobilityModel> ();
+    mobility->SetPosition (Vector (x, y, z));
+    node->AggregateObject (mobility);
+    Move (node->GetId (), Vector (x, y, z));
+  }
+
+  // Write the positions still held back and close the file.
+  void Close (void)
+  {
+    if (!m_file.is_open ())
+      {
+        return;
+      }
+    for (TraceSinks<Tracker>::Iterator t = m_trackers.Begin (); t != m_trackers.End (); ++t)
+      {
+        if (t->pending)
+          {
+            WriteMove (t->nodeId, t->position);
+            t->pending = false;
+          }
+      }
+    m_file.close ();
+  }
+
+private:
+  // per node, bound into the CourseChange and packet callbacks
+  struct Tracker
+  {
+    Tracker (AnimRecorder *r, uint32_t id)
+      : recorder (r),
+        nodeId (id),
+        lastMove (Seconds (0)),
+        moved (false),
+        pending (false)
+    {
+    }
+
+    AnimRecorder *recorder;
+    uint32_t nodeId;
+    Time lastMove;
+    bool moved;
+    bool pending;
+    Vector position;
+  };
+
+  void Install (Ptr<Node> node)
+  {
+    Tracker *t = m_trackers.Add (Tracker (this, node->GetId ()));
+    Ptr<MobilityModel> mobility = node->GetObject<MobilityModel> ();
+    Vector position = mobility != 0 ? mobility->GetPosition () : Vector ();
+    PutHeader (NODE, node->GetId ());
+    PutDouble (position.x);
+    PutDouble (position.y);
+    if (mobility != 0)
+      {
+        m_trackers.Connect (mobility, "CourseChange", &AnimRecorder::CourseChanged, t);
+      }
+    for (uint32_t i = 0; i < node->GetNDevices (); ++i)
+      {
+        Ptr<NetDevice> device = node->GetDevice (i);
+        Ptr<WifiNetDevice> wifi = DynamicCast<WifiNetDevice> (device);
+        if (wifi != 0)
+          {
+            m_trackers.Connect (wifi->GetPhy (), "PhyTxBegin", &AnimRecorder::TxBegin, t);
+            m_trackers.Connect (wifi->GetPhy (), "PhyRxEnd", &AnimRecorder::RxEnd, t);
+          }
+        else if (DynamicCast<CsmaNetDevice> (device) != 0 || DynamicCast<PointToPointNetDevice> (device) != 0)
+          {
+            m_trackers.Connect (device, "PhyTxBegin", &AnimRecorder::WiredTxBegin, t);
+            m_trackers.Connect (device, "PhyRxEnd", &AnimRecorder::WiredRxEnd, t);
+          }
+      }
+  }
+
+  static void CourseChanged (Tracker *t, Ptr<const MobilityModel> mobility)
+  {
+    t->recorder->Move (t->nodeId, mobility->GetPosition ());
+  }
+
+  static void TxBegin (Tracker *t, Ptr<const Packet> p)
+  {
+    t->recorder->Tx (t->nodeId, p, false);
+  }
+
+  static void RxEnd (Tracker *t, Ptr<const Packet> p)
+  {
+    t->recorder->Rx (t->nodeId, p, false);
+  }
+
+  // anim2xml.py pairs wired sends with their receptions
+  static void WiredTxBegin (Tracker *t, Ptr<const Packet> p)
+  {
+    t->recorder->Tx (t->nodeId, p, true);
+  }
+
+  static void WiredRxEnd (Tracker *t, Ptr<const Packet> p)
+  {
+    t->recorder->Rx (t->nodeId, p, true);
+  }
+
+  void Move (uint32_t nodeId, Vector position)
+  {
+    Tracker *t = Find (nodeId);
+    Time now = Simulator::Now ();
+    if (t == 0)
+      {
+        WriteMove (nodeId, position);
+        return;
+      }
+    if (t->moved && now < t->lastMove + m_positionInterval)
+      {
+        if (!t->pending)
+          {
+            Simulator::Schedule (t->lastMove + m_positionInterval - now, &AnimRecorder::Flush, this, t);
+          }
+        t->pending = true;
+        t->position = position;
+        return;
+      }
+    t->moved = true;
+    t->pending = false;
+    t->lastMove = now;
+    WriteMove (nodeId, position);
+  }
+
+  // Write the position held back since the last one written.
+  void Flush (Tracker *t)
+  {
+    if (t->pending && m_file.is_open ())
+      {
+        t->pending = false;
+        t->lastMove = Simulator::Now ();
+        WriteMove (t->nodeId, t->position);
+      }
+  }
+
+  bool Sampled (Ptr<const Packet> p) const
+  {
+    Time now = Simulator::Now ();
+    return m_packets && m_file.is_open () && now >= m_start && now < m_stop
+           && p->GetUid () % m_sampling == 0;
+  }
+
+  void Tx (uint32_t nodeId, Ptr<const Packet> p, bool wired)
+  {
+    if (!Sampled (p))
+      {
+        return;
+      }
+    std::string meta;
+    if (m_metadata)
+      {
+        std::ostringstream oss;
+        p->Print (oss);
+        meta = oss.str ();
+      }
+    PutHeader (TX, nodeId, wired);
+    Put64 (p->GetUid ());
+    Put32 (p->GetSize ());
+    Put32 (meta.size ());
+    m_file.write (meta.data (), meta.size ());
+  }
+
+  void Rx (uint32_t nodeId, Ptr<const Packet> p, bool wired)
+  {
+    if (!Sampled (p))
+      {
+        return;
+      }
+    PutHeader (RX, nodeId, wired);
+    Put64 (p->GetUid ());
+  }
+
+  Tracker *Find (uint32_t nodeId)
+  {
+    // trackers are created in node id order by the constructor
+    if (nodeId < m_trackers.GetN () && m_trackers.Get (nodeId).nodeId == nodeId)
+      {
+        return &m_trackers.Get (nodeId);
+      }
+    return 0;
+  }
+
+  void WriteMove (uint32_t nodeId, Vector position)
+  {
+    PutHeader (MOVE, nodeId);
+    PutDouble (position.x);
+    PutDouble (position.y);
+  }
+
+  void PutHeader (uint8_t type, uint32_t nodeId, bool wired = false)
+  {
+    NS_ABORT_MSG_UNLESS (m_file.is_open (), "AnimRecorder already closed");
+    m_file.put (type);
+    m_file.put (wired ? 1 : 0);
+    m_file.put (0);
+    m_file.put (0);
+    Put32 (nodeId);
+    Put64 (Simulator::Now ().GetNanoSeconds ());
+  }
+
+  void Put32 (uint32_t v)
+  {
+    for (int i = 0; i < 4; ++i)
+      {
+        m_file.put ((v >> (8 * i)) & 0xff);
+      }
+  }
+
+  void Put64 (uint64_t v)
+  {
+    for (int i = 0; i < 8; ++i)
+      {
+        m_file.put ((v >> (8 * i)) & 0xff);
+      }
+  }
+
+  void PutDouble (double d)
+  {
+    uint64_t v;
+    std::memcpy (&v, &d, sizeof (v));
+    Put64 (v);
+  }
+
+  std::ofstream m_file;
+  Time m_start;
+  Time m_stop;
+  Time m_positionInterval;
+  uint32_t m_sampling;
+  bool m_packets;
+  bool m_metadata;
+  TraceSinks<Tracker> m_trackers;
+};
+
+} // namespace ns3
+
+#endif /* ANIM_RECORDER_H */
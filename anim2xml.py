@@ -0,0 +1,121 @@
+#!/usr/bin/env python
+#
+# Convert an animation recording (see anim-recorder.h) to NetAnim XML.
+#
+#   python scratch/anim2xml.py xml/adhoc3.anim xml/adhoc3.xml
+#
+# The output is the netanim-3.107 format AnimationInterface writes: node
+# elements, "nu" updates for colors, sizes, descriptions and positions,
+# and the packets as AnimationInterface writes them: a "pr" element for
+# each wifi transmission and a "wpr" element for each wifi reception
+# (matched by uId), and one "p" element per CSMA or point-to-point
+# reception, paired here with its transmission.  The recording has the
+# first bit sent and the last bit received only, so fbTx = lbTx and
+# fbRx = lbRx.
+#
+# --start / --stop (seconds) keep only the records inside the window;
+# node placements, colors and sizes before it are kept.
+#
+
+from __future__ import print_function
+
+import argparse
+import struct
+import sys
+from xml.sax.saxutils import quoteattr
+
+MAGIC = b"NS3ANI01"
+HEADER = struct.Struct("<BB2xIQ")
+NODE, MOVE, COLOR, SIZE, DESCR, TX, RX = range(7)
+XY = struct.Struct("<dd")
+RGB = struct.Struct("<BBBx")
+TXINFO = struct.Struct("<QII")
+UID = struct.Struct("<Q")
+U32 = struct.Struct("<I")
+
+
+def read_exact(f, n):
+    data = f.read(n)
+    if len(data) < n:
+        raise EOFError
+    return data
+
+
+def records(f):
+    """Yield (type, wired, node, seconds, fields)."""
+    if f.read(16)[:8] != MAGIC:
+        sys.exit("not an animation recording")
+    while True:
+        try:
+            raw = f.read(HEADER.size)
+            if len(raw) < HEADER.size:
+                return
+            kind, wired, node, t = HEADER.unpack(raw)
+            if kind in (NODE, MOVE, SIZE):
+                fields = XY.unpack(read_exact(f, XY.size))
+            elif kind == COLOR:
+                fields = RGB.unpack(read_exact(f, RGB.size))
+            elif kind == DESCR:
+                (length,) = U32.unpack(read_exact(f, U32.size))
+                fields = (read_exact(f, length).decode("utf-8", "replace"),)
+            elif kind == TX:
+                uid, size, length = TXINFO.unpack(read_exact(f, TXINFO.size))
+                fields = (uid, size, read_exact(f, length).decode("utf-8", "replace"))
+            elif kind == RX:
+                fields = UID.unpack(read_exact(f, UID.size))
+            else:
+                sys.exit("unknown record type {0}".format(kind))
+        except EOFError:
+            # a run that did not Close () the recorder
+            print("warning: truncated recording", file=sys.stderr)
+            return
+        yield kind, wired, node, t / 1e9, fields
+
+
+def convert(f, out, start, stop):
+    out.write('<anim ver="netanim-3.107" filetype="animation" >\n')
+    sent = {}  # wired uid -> (node, time, meta) of its last transmission
+    for kind, wired, node, t, fields in records(f):
+        inside = start <= t < stop
+        if kind == NODE:
+            out.write('<node id="{0}" sysId="0" locX="{1}" locY="{2}" />\n'.format(node, *fields))
+        elif kind == COLOR:
+            out.write('<nu p="c" t="{0}" id="{1}" r="{2}" g="{3}" b="{4}" />\n'.format(t, node, *fields))
+        elif kind == SIZE:
+            out.write('<nu p="s" t="{0}" id="{1}" w="{2}" h="{3}" />\n'.format(t, node, *fields))
+        elif kind == DESCR:
+            out.write('<nu p="d" t="{0}" id="{1}" descr={2} />\n'.format(t, node, quoteattr(fields[0])))
+        elif kind == MOVE and (inside or t < start):
+            out.write('<nu p="p" t="{0}" id="{1}" x="{2}" y="{3}" />\n'.format(t, node, *fields))
+        elif kind == TX and wired:
+            uid, size, meta = fields
+            sent[uid] = (node, t, meta)
+        elif kind == TX and inside:
+            uid, size, meta = fields
+            out.write('<pr uId="{0}" fId="{1}" fbTx="{2}" meta-info={3} />\n'.format(
+                uid, node, t, quoteattr(meta)))
+        elif kind == RX and wired:
+            # a CSMA frame is received by every other device on the channel
+            tx = sent.get(fields[0])
+            if tx is not None and start <= tx[1] < stop:
+                out.write('<p fId="{0}" fbTx="{1}" lbTx="{1}" meta-info={2} tId="{3}" fbRx="{4}" lbRx="{4}" />\n'.format(
+                    tx[0], tx[1], quoteattr(tx[2]), node, t))
+        elif kind == RX and inside:
+            out.write('<wpr uId="{0}" tId="{1}" fbRx="{2}" lbRx="{2}" />\n'.format(fields[0], node, t))
+    out.write("</anim>\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="convert an animation recording to NetAnim XML")
+    parser.add_argument("recording")
+    parser.add_argument("output")
+    parser.add_argument("--start", type=float, default=0.0)
+    parser.add_argument("--stop", type=float, default=float("inf"))
+    opts = parser.parse_args()
+
+    with open(opts.recording, "rb") as f, open(opts.output, "w") as out:
+        convert(f, out, opts.start, opts.stop)
+
+
+if __name__ == "__main__":
+    main()
@@ -7,6 +7,7 @@
 #include "ns3/csma-module.h"
 #include "ns3/internet-module.h"
 #include "ns3/netanim-module.h"
+#include "pcap-capture.h"
 
 //set the same ssid, does't make sense to result 
 //
@@ -187,14 +188,18 @@ int main(int argc, char *argv[])
     Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
 
     Simulator::Stop (Seconds(10.0));
+    // one pcapng with every csma and wifi interface; see pcap-capture.h to
+    // sample, window, cut or filter (e.g. CaptureFilter::Olsr ()) the packets
+    PcapCapture capture;
     if(tracing == true){
-        csma.EnablePcapAll("pcap/apcsmaext1");
-        phy.EnablePcapAll("pcap/apcsmaext1");
+        capture.Open("pcap/apcsmaext1.pcapng");
+        capture.AddAll();
     }
 
     AnimationInterface anim("xml/apcsmaext1");
 
     Simulator::Run();
+    capture.Close();
     Simulator::Destroy();
     return 0;
 }
@@ -8,6 +8,7 @@
 #include "ns3/internet-module.h"
 #include "ns3/netanim-module.h"
 #include "ns3/olsr-helper.h"
+#include "pcap-capture.h"
 
 // add another two aps and a csma line
 // the global routes doesn't work
@@ -241,14 +242,18 @@ int main(int argc, char *argv[])
     //Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
 
     Simulator::Stop (Seconds(10.0));
+    // one pcapng with every csma and wifi interface; see pcap-capture.h to
+    // sample, window, cut or filter (e.g. CaptureFilter::Olsr ()) the packets
+    PcapCapture capture;
     if(tracing == true){
-        csma.EnablePcapAll("pcap/apcsmaext4");
-        phy.EnablePcapAll("pcap/apcsmaext4");
+        capture.Open("pcap/apcsmaext4.pcapng");
+        capture.AddAll();
     }
 
     AnimationInterface anim("xml/apcsmaext4.xml");
 
     Simulator::Run();
+    capture.Close();
     Simulator::Destroy();
     return 0;
 }
@@ -14,6 +14,7 @@
 #include "ns3/dsr-helper.h"
 #include "ns3/dsdv-helper.h"
 #include "ns3/rip-helper.h"
+#include "pcap-capture.h"
 
 // add another two aps and a csma line
 // the global routes doesn't work
@@ -252,9 +253,12 @@ int main(int argc, char *argv[])
     clientApps.Stop (Seconds (10.0));
 
     Simulator::Stop (Seconds(10.0));
+    // one pcapng with every csma and wifi interface; see pcap-capture.h to
+    // sample, window, cut or filter (e.g. CaptureFilter::Olsr ()) the packets
+    PcapCapture capture;
     if(tracing == true){
-        csma.EnablePcapAll("pcap/apcsmaext5");
-        phy.EnablePcapAll("pcap/apcsmaext5");
+        capture.Open("pcap/apcsmaext5.pcapng");
+        capture.AddAll();
     }
 
     NS_LOG_INFO("Establish global routes");
@@ -267,6 +271,7 @@ int main(int argc, char *argv[])
     AnimationInterface anim("xml/apcsmaext5");
 
     Simulator::Run();
+    capture.Close();
     Simulator::Destroy();
     return 0;
 }
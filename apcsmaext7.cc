@@ -11,6 +11,7 @@
 #include <string>
 #include <sstream>
 #include <iostream>
+#include "pcap-capture.h"
 
 // add another two aps and a csma line
 // the global routes doesn't work
@@ -264,14 +265,18 @@ int main(int argc, char *argv[])
     sstr<<serverid;
     string strsid;
     sstr>>strsid;
+    // one pcapng with every csma and wifi interface; see pcap-capture.h to
+    // sample, window, cut or filter (e.g. CaptureFilter::Olsr ()) the packets
+    PcapCapture capture;
     if(tracing == true){
-        csma.EnablePcapAll("pcap/"+fileName+"-sid"+strsid);
-        phy.EnablePcapAll("pcap/"+fileName+"-sid"+strsid);
+        capture.Open("pcap/"+fileName+"-sid"+strsid+".pcapng");
+        capture.AddAll();
     }
 
     AnimationInterface anim("xml/apcsmaext7.xml");
 
     Simulator::Run();
+    capture.Close();
     Simulator::Destroy();
     return 0;
 }
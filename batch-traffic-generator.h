@@ -0,0 +1,331 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * One traffic generator for many sockets.
+ *
+ * The GenerateTraffic functions in the scratch programs schedule one event
+ * per packet and bind the socket, size, count, interval (and in
+ * gw-adhoc-multi-sources.cc a copy of the whole socket vector) into each
+ * of them.  BatchTrafficGenerator keeps one entry per source and a heap
+ * ordered by the next send time of each source; a single simulator event
+ * is pending at any time, for the earliest of them, and every source due
+ * at that instant is served by the same event.
+ *
+ * The sockets may belong to other nodes than the generator's.  Their
+ * sends and closes are then scheduled at once with the socket node's
+ * context (Simulator::ScheduleWithContext), so the packets leave in the
+ * context of the node that sends them, as if each node ran its own
+ * application.
+ *
+ * Payloads come from a PayloadPool: sources with the same packet size
+ * share one template and every packet sent is a copy of it.  With the
+ * SeqTsHeader the patterned bytes are still copied once per packet (see
+ * payload-pool.h).
+ *
+ * Sending models:
+ *   CONSTANT  one packet every 'interval'
+ *   POISSON   exponential inter-arrival times with mean 'interval'
+ *   ON_OFF    one packet every 'interval' for 'onTime', then 'offTime' silent
+ *
+ * A source's socket is closed once it has sent 'pktCount' packets, as
+ * GenerateTraffic did.
+ *
+ * Usage:
+ *   Ptr<BatchTrafficGenerator> gen = CreateObject<BatchTrafficGenerator> ();
+ *   gen->AddSource (socket, 1024, 20, Seconds (0.1));
+ *   gen->AddSource (otherSocket, 1024, 20, Seconds (0.1));
+ *   node->AddApplication (gen);
+ *   gen->SetStartTime (Seconds (31.0));
+ */
+
+#ifndef BATCH_TRAFFIC_GENERATOR_H
+#define BATCH_TRAFFIC_GENERATOR_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/seq-ts-header.h"
+
+#include "payload-pool.h"
+
+#include <vector>
+#include <queue>
+#include <functional>
+
+namespace ns3 {
+
+class BatchTrafficGenerator : public Application
+{
+public:
+  enum Model
+  {
+    CONSTANT,
+    POISSON,
+    ON_OFF
+  };
+
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::BatchTrafficGenerator")
+      .SetParent<Application> ()
+      .AddConstructor<BatchTrafficGenerator> ()
+    ;
+    return tid;
+  }
+
+  BatchTrafficGenerator ()
+    : m_seqTs (false),
+      m_sent (0)
+  {
+    m_exponential = CreateObject<ExponentialRandomVariable> ();
+  }
+
+  virtual ~BatchTrafficGenerator ()
+  {
+  }
+
+  /*
+   * Add a source sending 'pktCount' packets of 'pktSize' bytes on a
+   * connected socket.  Returns the index of the source.
+   */
+  uint32_t AddSource (Ptr<Socket> socket, uint32_t pktSize, uint32_t pktCount, Time interval)
+  {
+    Source s;
+    s.socket = socket;
+    s.payload = m_payloads.Get (pktSize);
+    s.remaining = pktCount;
+    s.interval = interval;
+    s.model = CONSTANT;
+    m_sources.push_back (s);
+    return m_sources.size () - 1;
+  }
+
+  void SetModel (uint32_t source, Model model)
+  {
+    m_sources[source].model = model;
+  }
+
+  void SetOnOff (uint32_t source, Time onTime, Time offTime)
+  {
+    m_sources[source].model = ON_OFF;
+    m_sources[source].onTime = onTime;
+    m_sources[source].offTime = offTime;
+  }
+
+  // Fill payloads with 'pattern' repeated instead of zeros.  Call before
+  // AddSource.
+  void SetPayloadPattern (std::string pattern)
+  {
+    m_payloads.SetPattern (pattern);
+  }
+
+  // Prepend a SeqTsHeader with a per-source sequence number to each packet.
+  void SetSeqTs (bool enable)
+  {
+    m_seqTs = enable;
+  }
+
+  /*
+   * Start now instead of at the start time, e.g. once the routes have
+   * converged.  Does nothing if the application has started already.
+   */
+  void StartNow (void)
+  {
+    if (m_startEvent.IsRunning ())
+      {
+        Simulator::Cancel (m_startEvent);
+        StartApplication ();
+      }
+  }
+
+  int64_t AssignStreams (int64_t stream)
+  {
+    m_exponential->SetStream (stream);
+    return 1;
+  }
+
+  uint64_t GetSent (void) const
+  {
+    return m_sent;
+  }
+
+protected:
+  virtual void DoDispose (void)
+  {
+    m_sources.clear ();
+    Application::DoDispose ();
+  }
+
+private:
+  struct Source
+  {
+    Source ()
+      : remaining (0),
+        model (CONSTANT),
+        seq (0)
+    {
+    }
+
+    Ptr<Socket> socket;
+    Ptr<const Packet> payload;
+    uint32_t remaining;
+    Time interval;
+    Model model;
+    Time onTime;
+    Time offTime;
+    Time onStart;
+    uint32_t seq;
+  };
+
+  // (next send time in ns, source index), earliest first
+  typedef std::pair<int64_t, uint32_t> Entry;
+  typedef std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > Heap;
+
+  virtual void StartApplication (void)
+  {
+    Time now = Simulator::Now ();
+    m_heap = Heap ();
+    for (uint32_t k = 0; k < m_sources.size (); ++k)
+      {
+        m_sources[k].onStart = now;
+        Due (k, now);
+      }
+    Arm ();
+  }
+
+  virtual void StopApplication (void)
+  {
+    Simulator::Cancel (m_event);
+    m_heap = Heap ();
+    for (uint32_t k = 0; k < m_sources.size (); ++k)
+      {
+        // sources that ran out were closed already
+        if (m_sources[k].remaining > 0)
+          {
+            m_sources[k].socket->Close ();
+          }
+      }
+  }
+
+  // Queue source 'k' at 'at', or close its socket if it has nothing left.
+  void Due (uint32_t k, Time at)
+  {
+    if (m_sources[k].remaining == 0)
+      {
+        uint32_t node = ForeignNode (k);
+        if (node == Simulator::NO_CONTEXT)
+          {
+            Close (k);
+          }
+        else
+          {
+            Simulator::ScheduleWithContext (node, Seconds (0), &BatchTrafficGenerator::Close, this, k);
+          }
+        return;
+      }
+    m_heap.push (Entry (at.GetTimeStep (), k));
+  }
+
+  void Arm (void)
+  {
+    if (!m_heap.empty ())
+      {
+        m_event = Simulator::Schedule (TimeStep (m_heap.top ().first) - Simulator::Now (),
+                                       &BatchTrafficGenerator::Fire, this);
+      }
+  }
+
+  void Fire (void)
+  {
+    Time now = Simulator::Now ();
+    while (!m_heap.empty () && m_heap.top ().first <= now.GetTimeStep ())
+      {
+        uint32_t k = m_heap.top ().second;
+        m_heap.pop ();
+        Source &s = m_sources[k];
+        uint32_t node = ForeignNode (k);
+        if (node == Simulator::NO_CONTEXT)
+          {
+            Send (k, s.seq);
+          }
+        else
+          {
+            Simulator::ScheduleWithContext (node, Seconds (0), &BatchTrafficGenerator::Send, this, k, s.seq);
+          }
+        s.seq++;
+        s.remaining--;
+        m_sent++;
+        Due (k, Next (s, now));
+      }
+    Arm ();
+  }
+
+  // Node of source 'k' if it is not the generator's, else NO_CONTEXT.
+  uint32_t ForeignNode (uint32_t k)
+  {
+    uint32_t node = m_sources[k].socket->GetNode ()->GetId ();
+    return node != GetNode ()->GetId () ? node : Simulator::NO_CONTEXT;
+  }
+
+  void Send (uint32_t k, uint32_t seq)
+  {
+    Source &s = m_sources[k];
+    Ptr<Packet> p = s.payload->Copy ();
+    if (m_seqTs)
+      {
+        SeqTsHeader seqTs;
+        seqTs.SetSeq (seq);
+        p->AddHeader (seqTs);
+      }
+    s.socket->Send (p);
+  }
+
+  void Close (uint32_t k)
+  {
+    m_sources[k].socket->Close ();
+  }
+
+  Time Next (Source &s, Time now)
+  {
+    switch (s.model)
+      {
+      case POISSON:
+        return now + Seconds (m_exponential->GetValue (s.interval.GetSeconds (), 0));
+      case ON_OFF:
+        if (now + s.interval - s.onStart >= s.onTime)
+          {
+            s.onStart = s.onStart + s.onTime + s.offTime;
+            return s.onStart;
+          }
+        return now + s.interval;
+      default:
+        return now + s.interval;
+      }
+  }
+
+  std::vector<Source> m_sources;
+  PayloadPool m_payloads;
+  Heap m_heap;
+  EventId m_event;
+  Ptr<ExponentialRandomVariable> m_exponential;
+  bool m_seqTs;
+  uint64_t m_sent;
+};
+
+} // namespace ns3
+
+#endif /* BATCH_TRAFFIC_GENERATOR_H */
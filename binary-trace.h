@@ -0,0 +1,372 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Binary PHY trace written off the event loop.
+ *
+ * EnableAsciiAll formats every PHY event as text, packet headers included,
+ * inside the simulation, and each EnablePcap file is written with its own
+ * small writes.  BinaryTraceWriter hooks the PHY State Tx and RxOk sources
+ * of the wifi devices and appends a fixed-layout record, plus the first
+ * 'snapLen' bytes of the frame, to an in-memory chunk.  Full chunks are
+ * handed to a writer thread (ns-3 SystemThread) that writes them to the
+ * file, so an event costs one memcpy.  If the writer falls behind by
+ * MAX_CHUNKS the simulation waits for it; nothing is dropped.
+ *
+ * A file name ending in .gz or .zst is compressed by a gzip / zstd
+ * process fed through a pipe, so compression does not run in the
+ * simulator either.
+ *
+ * btrace.py converts the file to per-device .pcap files (the frames are
+ * the same as WifiPhyHelper's DLT_IEEE802_11 pcap) or to .tr lines.
+ *
+ * File layout, little-endian:
+ *   header  "NS3BTR01", uint32 version (1), uint32 snapLen
+ *   record  uint64 time (ns), uint32 nodeId, uint32 ifIndex, uint8 event,
+ *           3 bytes padding, uint32 modeUid, uint32 length, uint32 captured,
+ *           then 'captured' bytes
+ *   event   0 MODE   defines modeUid; the bytes are the WifiMode name
+ *           1 TX     PHY State Tx
+ *           2 RX_OK  PHY State RxOk
+ *
+ * Usage:
+ *   BinaryTraceWriter trace;
+ *   trace.Open ("./scratch/myManet.btr.gz");
+ *   trace.EnableWifi (devices);
+ *   Simulator::Run ();
+ *   trace.Close ();
+ */
+
+#ifndef BINARY_TRACE_H
+#define BINARY_TRACE_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/system-thread.h"
+#include "ns3/system-mutex.h"
+#include "ns3/system-condition.h"
+
+#include "trace-binder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <set>
+
+namespace ns3 {
+
+class BinaryTraceWriter
+{
+public:
+  enum Event
+  {
+    MODE,
+    TX,
+    RX_OK
+  };
+
+  static const uint32_t CHUNK_SIZE = 1 << 20;
+  static const uint32_t MAX_CHUNKS = 64;     // queued before the simulation waits
+
+  BinaryTraceWriter ()
+    : m_file (0),
+      m_pipe (false),
+      m_snapLen (0),
+      m_closing (false)
+  {
+  }
+
+  ~BinaryTraceWriter ()
+  {
+    Close ();
+  }
+
+  /*
+   * Open 'fileName' and start the writer thread.  Frames are cut to
+   * 'snapLen' bytes, as the pcap snaplen.
+   */
+  void Open (std::string fileName, uint32_t snapLen = 65535)
+  {
+    NS_ABORT_MSG_UNLESS (m_file == 0, "BinaryTraceWriter already open");
+    std::string command;
+    if (EndsWith (fileName, ".gz"))
+      {
+        command = "gzip -1 -c > '" + fileName + "'";
+      }
+    else if (EndsWith (fileName, ".zst"))
+      {
+        command = "zstd -q -1 -f -o '" + fileName + "'";
+      }
+    m_pipe = !command.empty ();
+    m_file = m_pipe ? popen (command.c_str (), "w") : std::fopen (fileName.c_str (), "wb");
+    NS_ABORT_MSG_UNLESS (m_file != 0, "Can't open " << fileName);
+
+    m_snapLen = snapLen;
+    m_closing = false;
+    m_current.reserve (CHUNK_SIZE);
+    m_current.insert (m_current.end (), "NS3BTR01", "NS3BTR01" + 8);
+    Put32 (m_current, 1);
+    Put32 (m_current, snapLen);
+    m_thread = Create<SystemThread> (MakeCallback (&BinaryTraceWriter::Run, this));
+    m_thread->Start ();
+  }
+
+  // Trace the State Tx and RxOk sources of the PHY of every wifi device.
+  void EnableWifi (NetDeviceContainer devices)
+  {
+    for (NetDeviceContainer::Iterator i = devices.Begin (); i != devices.End (); ++i)
+      {
+        Ptr<WifiNetDevice> wifi = DynamicCast<WifiNetDevice> (*i);
+        if (wifi == 0)
+          {
+            continue;
+          }
+        PointerValue state;
+        wifi->GetPhy ()->GetAttribute ("State", state);
+        NS_ABORT_MSG_UNLESS (state.Get<WifiPhyStateHelper> () != 0, "PHY without a State helper");
+        Slot *slot = m_slots.Add (Slot (this, wifi->GetNode ()->GetId (), wifi->GetIfIndex ()));
+        m_slots.Connect (state.Get<WifiPhyStateHelper> (), "Tx", &BinaryTraceWriter::Tx, slot);
+        m_slots.Connect (state.Get<WifiPhyStateHelper> (), "RxOk", &BinaryTraceWriter::RxOk, slot);
+      }
+  }
+
+  // Every wifi device of every node, as EnablePcapAll / EnableAsciiAll.
+  void EnableWifiAll (void)
+  {
+    NetDeviceContainer devices;
+    for (NodeList::Iterator n = NodeList::Begin (); n != NodeList::End (); ++n)
+      {
+        for (uint32_t i = 0; i < (*n)->GetNDevices (); ++i)
+          {
+            devices.Add ((*n)->GetDevice (i));
+          }
+      }
+    EnableWifi (devices);
+  }
+
+  // Flush what is buffered, stop the writer thread and close the file.
+  void Close (void)
+  {
+    if (m_file == 0)
+      {
+        return;
+      }
+    Hand ();
+    {
+      CriticalSection cs (m_mutex);
+      m_closing = true;
+    }
+    m_ready.SetCondition (true);
+    m_ready.Signal ();
+    m_thread->Join ();
+    m_thread = 0;
+    if (m_pipe)
+      {
+        pclose (m_file);
+      }
+    else
+      {
+        std::fclose (m_file);
+      }
+    m_file = 0;
+  }
+
+private:
+  struct Slot
+  {
+    Slot (BinaryTraceWriter *w, uint32_t node, uint32_t dev)
+      : writer (w),
+        nodeId (node),
+        ifIndex (dev)
+    {
+    }
+
+    BinaryTraceWriter *writer;
+    uint32_t nodeId;
+    uint32_t ifIndex;
+  };
+
+  static void Tx (Slot *slot, Ptr<const Packet> p, WifiMode mode, WifiPreamble preamble, uint8_t power)
+  {
+    slot->writer->Record (TX, slot, mode, p);
+  }
+
+  static void RxOk (Slot *slot, Ptr<const Packet> p, double snr, WifiMode mode, WifiPreamble preamble)
+  {
+    slot->writer->Record (RX_OK, slot, mode, p);
+  }
+
+  void Record (uint8_t event, const Slot *slot, WifiMode mode, Ptr<const Packet> p)
+  {
+    if (m_file == 0)
+      {
+        return;
+      }
+    uint32_t modeUid = mode.GetUid ();
+    if (m_modes.insert (modeUid).second)
+      {
+        std::string name = mode.GetUniqueName ();
+        PutHeader (MODE, 0, 0, modeUid, name.size (), name.size ());
+        m_current.insert (m_current.end (), name.begin (), name.end ());
+      }
+    uint32_t size = p->GetSize ();
+    uint32_t captured = std::min (size, m_snapLen);
+    PutHeader (event, slot->nodeId, slot->ifIndex, modeUid, size, captured);
+    if (captured > 0)
+      {
+        size_t at = m_current.size ();
+        m_current.resize (at + captured);
+        p->CopyData (&m_current[at], captured);
+      }
+    if (m_current.size () >= CHUNK_SIZE)
+      {
+        Hand ();
+      }
+  }
+
+  void PutHeader (uint8_t event, uint32_t node, uint32_t dev, uint32_t modeUid, uint32_t size, uint32_t captured)
+  {
+    Put64 (m_current, Simulator::Now ().GetNanoSeconds ());
+    Put32 (m_current, node);
+    Put32 (m_current, dev);
+    m_current.push_back (event);
+    m_current.push_back (0);
+    m_current.push_back (0);
+    m_current.push_back (0);
+    Put32 (m_current, modeUid);
+    Put32 (m_current, size);
+    Put32 (m_current, captured);
+  }
+
+  static void Put32 (std::vector<uint8_t> &b, uint32_t v)
+  {
+    for (int i = 0; i < 4; ++i)
+      {
+        b.push_back ((v >> (8 * i)) & 0xff);
+      }
+  }
+
+  static void Put64 (std::vector<uint8_t> &b, uint64_t v)
+  {
+    for (int i = 0; i < 8; ++i)
+      {
+        b.push_back ((v >> (8 * i)) & 0xff);
+      }
+  }
+
+  // Queue the current chunk for the writer, waiting if it is far behind.
+  void Hand (void)
+  {
+    if (m_current.empty ())
+      {
+        return;
+      }
+    for (;;)
+      {
+        // SystemCondition stays set once signalled: clear it before looking
+        // at the queue, so that only a chunk written after this wakes us
+        m_drained.SetCondition (false);
+        {
+          CriticalSection cs (m_mutex);
+          if (m_full.size () < MAX_CHUNKS)
+            {
+              m_full.push_back (std::vector<uint8_t> ());
+              m_full.back ().swap (m_current);
+              if (!m_free.empty ())
+                {
+                  m_current.swap (m_free.back ());
+                  m_free.pop_back ();
+                }
+              break;
+            }
+        }
+        m_drained.TimedWait (1000000);  // 1 ms
+      }
+    m_current.clear ();
+    m_current.reserve (CHUNK_SIZE);
+    m_ready.SetCondition (true);
+    m_ready.Signal ();
+  }
+
+  // Writer thread: write queued chunks until Close ().
+  void Run (void)
+  {
+    std::vector<uint8_t> chunk;
+    for (;;)
+      {
+        bool closing;
+        // cleared before the check, as in Hand (): a chunk queued after it
+        // sets the condition again and the wait below returns at once
+        m_ready.SetCondition (false);
+        {
+          CriticalSection cs (m_mutex);
+          if (!chunk.empty ())
+            {
+              chunk.clear ();
+              m_free.push_back (std::vector<uint8_t> ());
+              m_free.back ().swap (chunk);
+            }
+          if (!m_full.empty ())
+            {
+              chunk.swap (m_full.front ());
+              m_full.pop_front ();
+            }
+          closing = m_closing;
+        }
+        if (!chunk.empty ())
+          {
+            std::fwrite (&chunk[0], 1, chunk.size (), m_file);
+            m_drained.SetCondition (true);
+            m_drained.Signal ();
+            continue;
+          }
+        if (closing)
+          {
+            return;
+          }
+        m_ready.TimedWait (10000000);  // 10 ms
+      }
+  }
+
+  static bool EndsWith (const std::string &s, const std::string &suffix)
+  {
+    return s.size () >= suffix.size () && s.compare (s.size () - suffix.size (), suffix.size (), suffix) == 0;
+  }
+
+  std::FILE *m_file;
+  bool m_pipe;
+  uint32_t m_snapLen;
+  std::vector<uint8_t> m_current;
+  std::set<uint32_t> m_modes;
+  TraceSinks<Slot> m_slots;
+
+  // shared with the writer thread
+  SystemMutex m_mutex;
+  std::deque<std::vector<uint8_t> > m_full;
+  std::vector<std::vector<uint8_t> > m_free;
+  bool m_closing;
+  SystemCondition m_ready;
+  SystemCondition m_drained;
+  Ptr<SystemThread> m_thread;
+};
+
+} // namespace ns3
+
+#endif /* BINARY_TRACE_H */
@@ -0,0 +1,113 @@
+#!/usr/bin/env python
+#
+# Convert a binary PHY trace (see binary-trace.h) to the classic formats.
+#
+#   python scratch/btrace.py pcap scratch/myManet.btr.gz pcap/adhoc3
+#       writes pcap/adhoc3-<node>-<ifIndex>.pcap, one per device, with the
+#       same 802.11 frames as WifiPhyHelper::EnablePcap (DLT_IEEE802_11)
+#
+#   python scratch/btrace.py ascii scratch/myManet.btr.gz scratch/myManet.tr
+#       writes one line per event in the EnableAsciiAll layout:
+#       t|r <seconds> <context> <mode> followed by the frame length; the
+#       headers are not decoded, use the pcap output for that
+#
+# --nodes=0,26 keeps only the given node ids.  .gz and .zst inputs are
+# decompressed on the fly.
+#
+
+from __future__ import print_function
+
+import argparse
+import gzip
+import struct
+import subprocess
+import sys
+
+MAGIC = b"NS3BTR01"
+RECORD = struct.Struct("<QIIB3xIII")
+MODE, TX, RX_OK = 0, 1, 2
+DLT_IEEE802_11 = 105
+
+
+def open_trace(name):
+    if name.endswith(".gz"):
+        return gzip.open(name, "rb")
+    if name.endswith(".zst"):
+        return subprocess.Popen(["zstd", "-dcq", name], stdout=subprocess.PIPE).stdout
+    return open(name, "rb")
+
+
+def read_exact(f, n):
+    data = f.read(n)
+    while len(data) < n:
+        more = f.read(n - len(data))
+        if not more:
+            break
+        data += more
+    return data
+
+
+def records(name):
+    """Yield (time_ns, node, ifIndex, event, mode name, length, bytes)."""
+    f = open_trace(name)
+    head = read_exact(f, 16)
+    if head[:8] != MAGIC:
+        sys.exit("{0}: not a binary trace".format(name))
+    modes = {}
+    while True:
+        raw = read_exact(f, RECORD.size)
+        if len(raw) < RECORD.size:
+            break
+        t, node, dev, event, mode, length, captured = RECORD.unpack(raw)
+        data = read_exact(f, captured)
+        if event == MODE:
+            modes[mode] = data.decode("ascii")
+            continue
+        yield t, node, dev, event, modes.get(mode, str(mode)), length, data
+
+
+def to_pcap(name, prefix, nodes, snaplen):
+    files = {}
+    for t, node, dev, event, mode, length, data in records(name):
+        if nodes is not None and node not in nodes:
+            continue
+        out = files.get((node, dev))
+        if out is None:
+            out = open("{0}-{1}-{2}.pcap".format(prefix, node, dev), "wb")
+            out.write(struct.pack("<IHHiIII", 0xa1b2c3d4, 2, 4, 0, 0, snaplen, DLT_IEEE802_11))
+            files[(node, dev)] = out
+        out.write(struct.pack("<IIII", t // 1000000000, (t // 1000) % 1000000, len(data), length))
+        out.write(data)
+    for out in files.values():
+        out.close()
+    print("wrote {0} pcap files".format(len(files)))
+
+
+def to_ascii(name, path, nodes):
+    with open(path, "w") as out:
+        for t, node, dev, event, mode, length, data in records(name):
+            if nodes is not None and node not in nodes:
+                continue
+            out.write("{0} {1:g} /NodeList/{2}/DeviceList/{3}/$ns3::WifiNetDevice/Phy/State/{4} {5} length: {6}\n".format(
+                "t" if event == TX else "r", t / 1e9, node, dev, "Tx" if event == TX else "RxOk", mode, length))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="convert a binary PHY trace")
+    parser.add_argument("format", choices=["pcap", "ascii"])
+    parser.add_argument("trace")
+    parser.add_argument("output", help="pcap file prefix, or .tr file")
+    parser.add_argument("--nodes", help="comma-separated node ids to keep")
+    opts = parser.parse_args()
+
+    nodes = set(int(n) for n in opts.nodes.split(",")) if opts.nodes else None
+    if opts.format == "pcap":
+        with open_trace(opts.trace) as f:
+            snaplen = struct.unpack("<II", read_exact(f, 16)[8:])[1]
+        to_pcap(opts.trace, opts.output, nodes, snaplen)
+    else:
+        to_ascii(opts.trace, opts.output, nodes)
+
+
+if __name__ == "__main__":
+    main()
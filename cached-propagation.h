@@ -0,0 +1,398 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Node-pair caches of propagation loss and delay for static topologies.
+ *
+ * The channel asks its loss and delay models for every (sender, receiver)
+ * pair on every frame, although with ConstantPositionMobilityModel the
+ * answer never changes.  CachedPropagationLossModel and
+ * CachedPropagationDelayModel wrap the scenario's models and keep an
+ * N x N matrix indexed by node id:
+ *
+ *   Precompute (nodes)  fills the matrix once, after mobility is installed
+ *   lookups             map each MobilityModel to its node id and index
+ *                       the matrix; a missing entry is computed by the
+ *                       wrapped model and stored
+ *   CourseChange        of a node's mobility model invalidates its row
+ *                       and column, so a node that jumps is recomputed
+ *   moving nodes        (non-zero velocity, e.g. ConstantVelocity or
+ *                       RandomWalk2d between course changes) bypass the
+ *                       cache, as in grid-spectrum-channel.h: their
+ *                       position changes without a CourseChange
+ *
+ * A mobility model is resolved once, the first time it is seen: its node
+ * id comes from GetObject<Node> and its velocity from GetVelocity.  After
+ * that a lookup is a map search per model, and the moving state is only
+ * refreshed on CourseChange, which ns-3's models fire whenever their
+ * velocity changes.
+ *
+ * The loss cache stores the gain, i.e. rx - tx power, so the wrapped model
+ * must be deterministic and linear in the tx power (Friis, LogDistance,
+ * ThreeLogDistance, Range...), not a fading model.  Mobility models that
+ * are not aggregated to a node are passed through uncached.
+ *
+ * Whether this beats calling Friis or LogDistance directly depends on the
+ * build and the node count, so the scenarios leave it off unless asked
+ * for (--cachePropagation); time a run both ways before turning it on.
+ *
+ * Usage:
+ *   Ptr<CachedPropagationLossModel> loss = CreateObject<CachedPropagationLossModel> ();
+ *   loss->SetModel (CreateObject<FriisPropagationLossModel> ());
+ *   channel->SetPropagationLossModel (loss);
+ *   ...
+ *   mobility.Install (nodes);
+ *   loss->Precompute (nodes);
+ */
+
+#ifndef CACHED_PROPAGATION_H
+#define CACHED_PROPAGATION_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-module.h"
+
+#include "trace-binder.h"
+
+#include <vector>
+#include <map>
+
+namespace ns3 {
+
+/*
+ * Matrix of T per (node id, node id) with a valid flag, invalidated per
+ * node on CourseChange.  Shared by the loss and delay wrappers.
+ */
+template <typename T>
+class NodePairCache
+{
+public:
+  NodePairCache ()
+    : m_hits (0),
+      m_misses (0)
+  {
+  }
+
+  /*
+   * True if 'm' is aggregated to a node that is not moving, i.e. its
+   * values can be cached, with the node id in 'id'.  The first call for a
+   * model looks up its node and hooks its CourseChange.
+   */
+  bool IsStatic (Ptr<MobilityModel> m, uint32_t &id)
+  {
+    std::map<const MobilityModel *, int64_t>::const_iterator i = m_ids.find (PeekPointer (m));
+    int64_t found;
+    if (i != m_ids.end ())
+      {
+        found = i->second;
+      }
+    else
+      {
+        Ptr<Node> node = m->GetObject<Node> ();
+        found = node != 0 ? static_cast<int64_t> (node->GetId ()) : -1;
+        m_ids[PeekPointer (m)] = found;
+        if (found >= 0)
+          {
+            Watch (found, m);
+          }
+      }
+    if (found < 0 || m_moving[found])
+      {
+        return false;
+      }
+    id = found;
+    return true;
+  }
+
+  bool Lookup (uint32_t a, uint32_t b, T &value)
+  {
+    if (a < m_matrix.size () && b < m_matrix[a].size () && m_matrix[a][b].first)
+      {
+        value = m_matrix[a][b].second;
+        m_hits++;
+        return true;
+      }
+    m_misses++;
+    return false;
+  }
+
+  // Store the value of (a, b), two ids returned by IsStatic.
+  void Store (uint32_t a, uint32_t b, T value)
+  {
+    if (m_matrix[a].size () <= b)
+      {
+        m_matrix[a].resize (b + 1, std::make_pair (false, T ()));
+      }
+    m_matrix[a][b] = std::make_pair (true, value);
+  }
+
+  // Forget every value; the node ids and CourseChange hooks stay in place.
+  void Clear (void)
+  {
+    for (uint32_t a = 0; a < m_matrix.size (); ++a)
+      {
+        m_matrix[a].clear ();
+      }
+  }
+
+  uint64_t GetHits (void) const
+  {
+    return m_hits;
+  }
+
+  uint64_t GetMisses (void) const
+  {
+    return m_misses;
+  }
+
+private:
+  struct Watcher
+  {
+    NodePairCache *cache;
+    uint32_t id;
+  };
+
+  void Watch (uint32_t id, Ptr<MobilityModel> m)
+  {
+    if (m_matrix.size () <= id)
+      {
+        m_matrix.resize (id + 1);
+        m_watched.resize (id + 1, false);
+        m_moving.resize (id + 1, false);
+      }
+    m_moving[id] = IsMoving (m);
+    if (!m_watched[id])
+      {
+        m_watched[id] = true;
+        Watcher w;
+        w.cache = this;
+        w.id = id;
+        m_watchers.Connect (m, "CourseChange", &NodePairCache::CourseChanged, m_watchers.Add (w));
+      }
+  }
+
+  static void CourseChanged (Watcher *w, Ptr<const MobilityModel> m)
+  {
+    w->cache->m_moving[w->id] = IsMoving (m);
+    w->cache->Invalidate (w->id);
+  }
+
+  // A node in motion: whatever is cached for it is already stale.
+  static bool IsMoving (Ptr<const MobilityModel> m)
+  {
+    Vector v = m->GetVelocity ();
+    return v.x != 0 || v.y != 0 || v.z != 0;
+  }
+
+  void Invalidate (uint32_t id)
+  {
+    if (id < m_matrix.size ())
+      {
+        m_matrix[id].clear ();
+      }
+    for (uint32_t a = 0; a < m_matrix.size (); ++a)
+      {
+        if (id < m_matrix[a].size ())
+          {
+            m_matrix[a][id].first = false;
+          }
+      }
+  }
+
+  std::vector<std::vector<std::pair<bool, T> > > m_matrix;
+  std::vector<bool> m_watched;
+  std::vector<bool> m_moving;
+  // node id of every mobility model seen, -1 if not aggregated to a node
+  std::map<const MobilityModel *, int64_t> m_ids;
+  TraceSinks<Watcher> m_watchers;
+  uint64_t m_hits;
+  uint64_t m_misses;
+};
+
+class CachedPropagationLossModel : public PropagationLossModel
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::CachedPropagationLossModel")
+      .SetParent<PropagationLossModel> ()
+      .AddConstructor<CachedPropagationLossModel> ()
+    ;
+    return tid;
+  }
+
+  CachedPropagationLossModel ()
+  {
+  }
+
+  void SetModel (Ptr<PropagationLossModel> model)
+  {
+    m_model = model;
+    m_cache.Clear ();
+  }
+
+  // Compute the gain of every ordered pair of 'nodes' now.
+  void Precompute (NodeContainer nodes)
+  {
+    for (NodeContainer::Iterator a = nodes.Begin (); a != nodes.End (); ++a)
+      {
+        Ptr<MobilityModel> ma = (*a)->GetObject<MobilityModel> ();
+        uint32_t ia;
+        if (ma == 0 || !m_cache.IsStatic (ma, ia))
+          {
+            continue;
+          }
+        for (NodeContainer::Iterator b = nodes.Begin (); b != nodes.End (); ++b)
+          {
+            Ptr<MobilityModel> mb = (*b)->GetObject<MobilityModel> ();
+            uint32_t ib;
+            if (a != b && mb != 0 && m_cache.IsStatic (mb, ib))
+              {
+                m_cache.Store (ia, ib, m_model->CalcRxPower (0, ma, mb));
+              }
+          }
+      }
+  }
+
+  const NodePairCache<double> &GetCache (void) const
+  {
+    return m_cache;
+  }
+
+protected:
+  virtual void DoDispose (void)
+  {
+    m_model = 0;
+    m_cache.Clear ();
+    PropagationLossModel::DoDispose ();
+  }
+
+private:
+  virtual double DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+  {
+    uint32_t ia;
+    uint32_t ib;
+    if (!m_cache.IsStatic (a, ia) || !m_cache.IsStatic (b, ib))
+      {
+        return m_model->CalcRxPower (txPowerDbm, a, b);
+      }
+    double gainDb;
+    if (!m_cache.Lookup (ia, ib, gainDb))
+      {
+        gainDb = m_model->CalcRxPower (0, a, b);
+        m_cache.Store (ia, ib, gainDb);
+      }
+    return txPowerDbm + gainDb;
+  }
+
+  virtual int64_t DoAssignStreams (int64_t stream)
+  {
+    return m_model->AssignStreams (stream);
+  }
+
+  Ptr<PropagationLossModel> m_model;
+  mutable NodePairCache<double> m_cache;
+};
+
+class CachedPropagationDelayModel : public PropagationDelayModel
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::CachedPropagationDelayModel")
+      .SetParent<PropagationDelayModel> ()
+      .AddConstructor<CachedPropagationDelayModel> ()
+    ;
+    return tid;
+  }
+
+  CachedPropagationDelayModel ()
+  {
+  }
+
+  void SetModel (Ptr<PropagationDelayModel> model)
+  {
+    m_model = model;
+    m_cache.Clear ();
+  }
+
+  void Precompute (NodeContainer nodes)
+  {
+    for (NodeContainer::Iterator a = nodes.Begin (); a != nodes.End (); ++a)
+      {
+        Ptr<MobilityModel> ma = (*a)->GetObject<MobilityModel> ();
+        uint32_t ia;
+        if (ma == 0 || !m_cache.IsStatic (ma, ia))
+          {
+            continue;
+          }
+        for (NodeContainer::Iterator b = nodes.Begin (); b != nodes.End (); ++b)
+          {
+            Ptr<MobilityModel> mb = (*b)->GetObject<MobilityModel> ();
+            uint32_t ib;
+            if (a != b && mb != 0 && m_cache.IsStatic (mb, ib))
+              {
+                m_cache.Store (ia, ib, m_model->GetDelay (ma, mb));
+              }
+          }
+      }
+  }
+
+  virtual Time GetDelay (Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+  {
+    uint32_t ia;
+    uint32_t ib;
+    if (!m_cache.IsStatic (a, ia) || !m_cache.IsStatic (b, ib))
+      {
+        return m_model->GetDelay (a, b);
+      }
+    Time delay;
+    if (!m_cache.Lookup (ia, ib, delay))
+      {
+        delay = m_model->GetDelay (a, b);
+        m_cache.Store (ia, ib, delay);
+      }
+    return delay;
+  }
+
+  const NodePairCache<Time> &GetCache (void) const
+  {
+    return m_cache;
+  }
+
+protected:
+  virtual void DoDispose (void)
+  {
+    m_model = 0;
+    m_cache.Clear ();
+    PropagationDelayModel::DoDispose ();
+  }
+
+private:
+  virtual int64_t DoAssignStreams (int64_t stream)
+  {
+    return m_model->AssignStreams (stream);
+  }
+
+  Ptr<PropagationDelayModel> m_model;
+  mutable NodePairCache<Time> m_cache;
+};
+
+} // namespace ns3
+
+#endif /* CACHED_PROPAGATION_H */
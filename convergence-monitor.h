@@ -0,0 +1,298 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Routing convergence detector.
+ *
+ * The OLSR scripts start their traffic at a fixed 31 s, long after the
+ * tables of a small grid have settled.  ConvergenceMonitor watches the
+ * routing tables of a set of nodes and calls back once, when
+ *
+ *   - every node has at least SetMinRoutes routes, and
+ *   - no table has changed for SetWindow,
+ *
+ * or at SetTimeout at the latest, so a run is never later than with the
+ * fixed start.
+ *
+ * OLSR tables are followed through the RoutingTableChanged trace.  Other
+ * protocols (AODV, DSDV, static) have no such trace: their
+ * PrintRoutingTable output is read every SetPollInterval, and the
+ * destination, gateway and interface columns are compared, so expiry
+ * times and sequence numbers do not count as changes.  A reactive
+ * protocol such as AODV only has its neighbors' routes before traffic,
+ * so SetMinRoutes should stay low for it.
+ *
+ * Usage:
+ *   ConvergenceMonitor convergence;
+ *   convergence.SetWindow (Seconds (6));
+ *   convergence.SetMinRoutes (numNodes - 1);
+ *   convergence.SetTimeout (Seconds (31));
+ *   convergence.Install (c, MakeCallback (&BatchTrafficGenerator::StartNow, traffic));
+ */
+
+#ifndef CONVERGENCE_MONITOR_H
+#define CONVERGENCE_MONITOR_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/olsr-routing-protocol.h"
+
+#include "route-journal.h"
+#include "trace-binder.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+class ConvergenceMonitor
+{
+public:
+  ConvergenceMonitor ()
+    : m_window (Seconds (6)),
+      m_timeout (Time::Max ()),
+      m_pollInterval (Seconds (1)),
+      m_minRoutes (1),
+      m_converged (false),
+      m_convergenceTime (Seconds (0))
+  {
+  }
+
+  // How long the tables must stay unchanged.
+  void SetWindow (Time window)
+  {
+    m_window = window;
+  }
+
+  // Call back at 'timeout' even if the tables have not settled.
+  void SetTimeout (Time timeout)
+  {
+    m_timeout = timeout;
+  }
+
+  // Routes every node needs before its table counts as settled.
+  void SetMinRoutes (uint32_t routes)
+  {
+    m_minRoutes = routes;
+  }
+
+  // How often the tables of non-OLSR nodes are read.
+  void SetPollInterval (Time interval)
+  {
+    m_pollInterval = interval;
+  }
+
+  /*
+   * Watch the routing tables of 'nodes' and call 'converged' once they
+   * have settled.  Call before Simulator::Run.
+   */
+  void Install (NodeContainer nodes, Callback<void> converged)
+  {
+    m_callback = converged;
+    bool poll = false;
+    for (NodeContainer::Iterator n = nodes.Begin (); n != nodes.End (); ++n)
+      {
+        Ptr<Ipv4> ipv4 = (*n)->GetObject<Ipv4> ();
+        NS_ABORT_MSG_UNLESS (ipv4 != 0, "Node " << (*n)->GetId () << " has no IPv4 stack");
+        Watched *w = m_watched.Add (Watched (this, (*n)->GetId (), ipv4->GetRoutingProtocol ()));
+        w->olsr = RouteJournal::FindOlsr (*n);
+        if (w->olsr != 0)
+          {
+            m_watched.Connect (w->olsr, "RoutingTableChanged", &ConvergenceMonitor::TableChanged, w);
+          }
+        else
+          {
+            poll = true;
+          }
+      }
+    if (poll)
+      {
+        m_pollEvent = Simulator::Schedule (m_pollInterval, &ConvergenceMonitor::Poll, this);
+      }
+    if (m_timeout != Time::Max ())
+      {
+        m_timeoutEvent = Simulator::Schedule (m_timeout, &ConvergenceMonitor::Fire, this);
+      }
+  }
+
+  bool IsConverged (void) const
+  {
+    return m_converged;
+  }
+
+  // Time the callback ran, by convergence or by timeout.
+  Time GetConvergenceTime (void) const
+  {
+    return m_convergenceTime;
+  }
+
+private:
+  struct Watched
+  {
+    Watched (ConvergenceMonitor *m, uint32_t id, Ptr<Ipv4RoutingProtocol> r)
+      : monitor (m),
+        nodeId (id),
+        routing (r),
+        routes (0)
+    {
+    }
+
+    ConvergenceMonitor *monitor;
+    uint32_t nodeId;
+    Ptr<Ipv4RoutingProtocol> routing;
+    Ptr<olsr::RoutingProtocol> olsr;
+    uint32_t routes;
+    std::string table;    // the routes compared between changes
+  };
+
+  /*
+   * OLSR recomputes its table, and fires the trace, for every OLSR packet
+   * it receives; only a different set of routes counts as a change.
+   */
+  static void TableChanged (Watched *w, uint32_t size)
+  {
+    std::vector<olsr::RoutingTableEntry> entries = w->olsr->GetRoutingTableEntries ();
+    std::ostringstream oss;
+    for (std::vector<olsr::RoutingTableEntry>::const_iterator e = entries.begin (); e != entries.end (); ++e)
+      {
+        oss << e->destAddr << " " << e->nextAddr << " " << e->interface << " " << e->distance << "\n";
+      }
+    if (oss.str () != w->table)
+      {
+        w->table = oss.str ();
+        w->routes = entries.size ();
+        w->monitor->Changed ();
+      }
+  }
+
+  void Poll (void)
+  {
+    if (m_converged)
+      {
+        return;
+      }
+    bool changed = false;
+    for (TraceSinks<Watched>::Iterator w = m_watched.Begin (); w != m_watched.End (); ++w)
+      {
+        if (w->olsr != 0)
+          {
+            continue;
+          }
+        uint32_t routes;
+        std::string table = Columns (w->routing, routes);
+        if (table != w->table)
+          {
+            w->table = table;
+            w->routes = routes;
+            changed = true;
+          }
+      }
+    if (changed)
+      {
+        Changed ();
+      }
+    m_pollEvent = Simulator::Schedule (m_pollInterval, &ConvergenceMonitor::Poll, this);
+  }
+
+  /*
+   * The first three columns (destination, gateway or next hop, interface)
+   * of the PrintRoutingTable lines, and the number of lines that start
+   * with an IPv4 address.
+   */
+  static std::string Columns (Ptr<Ipv4RoutingProtocol> routing, uint32_t &routes)
+  {
+    std::ostringstream oss;
+    routing->PrintRoutingTable (Create<OutputStreamWrapper> (&oss));
+    std::istringstream lines (oss.str ());
+    std::string line;
+    std::string columns;
+    routes = 0;
+    while (std::getline (lines, line))
+      {
+        std::istringstream fields (line);
+        std::string dest, gateway, itf;
+        fields >> dest >> gateway >> itf;
+        if (std::count (dest.begin (), dest.end (), '.') == 3
+            && dest.find_first_not_of ("0123456789.") == std::string::npos)
+          {
+            routes++;
+            columns += dest + " " + gateway + " " + itf + "\n";
+          }
+      }
+    return columns;
+  }
+
+  // A table changed: the window starts again.
+  void Changed (void)
+  {
+    if (m_converged)
+      {
+        return;
+      }
+    Simulator::Cancel (m_stableEvent);
+    m_stableEvent = Simulator::Schedule (m_window, &ConvergenceMonitor::Stable, this);
+  }
+
+  void Stable (void)
+  {
+    for (TraceSinks<Watched>::ConstIterator w = m_watched.Begin (); w != m_watched.End (); ++w)
+      {
+        if (w->routes < m_minRoutes)
+          {
+            // a node is still short of routes; its next change restarts the window
+            return;
+          }
+      }
+    Fire ();
+  }
+
+  void Fire (void)
+  {
+    if (m_converged)
+      {
+        return;
+      }
+    m_converged = true;
+    m_convergenceTime = Simulator::Now ();
+    Simulator::Cancel (m_stableEvent);
+    Simulator::Cancel (m_timeoutEvent);
+    Simulator::Cancel (m_pollEvent);
+    if (!m_callback.IsNull ())
+      {
+        m_callback ();
+      }
+  }
+
+  Time m_window;
+  Time m_timeout;
+  Time m_pollInterval;
+  uint32_t m_minRoutes;
+  bool m_converged;
+  Time m_convergenceTime;
+  Callback<void> m_callback;
+  EventId m_stableEvent;
+  EventId m_timeoutEvent;
+  EventId m_pollEvent;
+  TraceSinks<Watched> m_watched;
+};
+
+} // namespace ns3
+
+#endif /* CONVERGENCE_MONITOR_H */
@@ -31,6 +31,8 @@
 #include <vector>
 #include <string>
 
+#include "batch-traffic-generator.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("EnergyExample");
@@ -68,31 +70,6 @@ ReceivePacket (Ptr<Socket> socket)
     }
 }
 
-/**
- * \param socket Pointer to socket.
- * \param pktSize Packet size.
- * \param n Pointer to node.
- * \param pktCount Number of packets to generate.
- * \param pktInterval Packet sending interval.
- *
- * Traffic generator.
- */
-static void
-GenerateTraffic (Ptr<Socket> socket, uint32_t pktSize, Ptr<Node> n,
-                 uint32_t pktCount, Time pktInterval)
-{
-  if (pktCount > 0)
-    {
-      socket->Send (Create<Packet> (pktSize));
-      Simulator::Schedule (pktInterval, &GenerateTraffic, socket, pktSize, n,
-                           pktCount - 1, pktInterval);
-    }
-  else
-    {
-      socket->Close ();
-    }
-}
-
 /// Trace function for remaining energy at node.
 void
 RemainingEnergy (double oldValue, double remainingEnergy)
@@ -261,8 +238,10 @@ main (int argc, char *argv[])
 
   /** simulation setup **/
   // start traffic
-  Simulator::Schedule (Seconds (startTime), &GenerateTraffic, source, PpacketSize,
-                       networkNodes.Get (0), numPackets, interPacketInterval);
+  Ptr<BatchTrafficGenerator> traffic = CreateObject<BatchTrafficGenerator> ();
+  traffic->AddSource (source, PpacketSize, numPackets, interPacketInterval);
+  networkNodes.Get (0)->AddApplication (traffic);
+  traffic->SetStartTime (Seconds (startTime));
 
   Simulator::Stop (Seconds (10.0));
   Simulator::Run ();
@@ -0,0 +1,96 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * One FlowMonitor read per tick, shared by the periodic monitors.
+ *
+ * FlowMonitor::GetFlowStats returns the whole std::map<FlowId, FlowStats>
+ * by value in this ns-3 release, histograms included; there is no
+ * read-only view of the monitor's own map.  The monitors called it once
+ * each per tick (series and rates, snapshot), and indexing the copy with
+ * operator[] inserts an empty flow when the id is absent.
+ *
+ * FlowCounterTable::Update takes that one copy per tick and nothing else:
+ * the consumers iterate it, look flows up with Find () (never inserting),
+ * and FlowSnapshotWriter::Write gets it through GetStats ().  It does not
+ * call CheckForLostPackets, which walks every packet in flight;
+ * FlowMonitor already runs it every second on its own, and lostPackets
+ * is what that check has found so far.
+ */
+
+#ifndef FLOW_COUNTERS_H
+#define FLOW_COUNTERS_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/flow-monitor-module.h"
+
+#include <map>
+
+namespace ns3 {
+
+class FlowCounterTable
+{
+public:
+  typedef std::map<FlowId, FlowMonitor::FlowStats> Stats;
+  typedef Stats::const_iterator Iterator;
+
+  FlowCounterTable ()
+  {
+  }
+
+  // Read the monitor: the one GetFlowStats copy of this tick.
+  void Update (Ptr<FlowMonitor> monitor)
+  {
+    Stats stats = monitor->GetFlowStats ();
+    m_stats.swap (stats);
+  }
+
+  /*
+   * The stats read by the last Update.  Not const: Histogram::GetBinCount
+   * is not.
+   */
+  Stats &GetStats (void)
+  {
+    return m_stats;
+  }
+
+  // Null if no packet of 'flowId' has been seen; never inserts.
+  const FlowMonitor::FlowStats *Find (FlowId flowId) const
+  {
+    Iterator i = m_stats.find (flowId);
+    return i != m_stats.end () ? &i->second : 0;
+  }
+
+  Iterator Begin (void) const
+  {
+    return m_stats.begin ();
+  }
+
+  Iterator End (void) const
+  {
+    return m_stats.end ();
+  }
+
+private:
+  Stats m_stats;
+};
+
+} // namespace ns3
+
+#endif /* FLOW_COUNTERS_H */
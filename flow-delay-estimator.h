@@ -0,0 +1,376 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Per-flow streaming delay statistics at the sink.
+ *
+ * DelayJitterEstimation keeps one last delay and one jitter for everything
+ * it sees, so a single global instance mixes all senders.  Here the sender
+ * stamps each packet with FlowDelayEstimator::Stamp() and the sink passes
+ * each received packet and its source address to Record().  Every source
+ * address gets its own DelayStats:
+ *
+ *   count, min, max
+ *   mean and variance (Welford's update, numerically stable)
+ *   jitter, mean |D(i) - D(i-1)| as FlowMonitor computes it
+ *   P50, P95, P99 with the P-square algorithm (Jain & Chlamtac, 1985)
+ *
+ * A P-square estimator holds five markers whatever the number of samples,
+ * so the memory per flow is constant and a 1000-STA run does not keep a
+ * sample per packet.
+ *
+ * Usage:
+ *   FlowDelayEstimator delays;
+ *   FlowDelayEstimator::Stamp (packet);                      // sender
+ *   sink->TraceConnectWithoutContext ("Rx",
+ *     MakeCallback (&FlowDelayEstimator::Record, &delays));  // sink
+ *   delays.Print (std::cout);
+ */
+
+#ifndef FLOW_DELAY_ESTIMATOR_H
+#define FLOW_DELAY_ESTIMATOR_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include <map>
+
+namespace ns3 {
+
+// Send time of a packet, carried as a byte tag so it survives headers
+// and fragmentation.
+class DelayTimestampTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::DelayTimestampTag")
+      .SetParent<Tag> ()
+      .AddConstructor<DelayTimestampTag> ()
+    ;
+    return tid;
+  }
+
+  DelayTimestampTag ()
+    : m_txTime (Simulator::Now ().GetTimeStep ())
+  {
+  }
+
+  virtual TypeId GetInstanceTypeId (void) const
+  {
+    return GetTypeId ();
+  }
+
+  virtual uint32_t GetSerializedSize (void) const
+  {
+    return 8;
+  }
+
+  virtual void Serialize (TagBuffer i) const
+  {
+    i.WriteU64 (m_txTime);
+  }
+
+  virtual void Deserialize (TagBuffer i)
+  {
+    m_txTime = i.ReadU64 ();
+  }
+
+  virtual void Print (std::ostream &os) const
+  {
+    os << "txTime=" << TimeStep (m_txTime);
+  }
+
+  Time GetTxTime (void) const
+  {
+    return TimeStep (m_txTime);
+  }
+
+private:
+  int64_t m_txTime;
+};
+
+/*
+ * P-square estimate of the p-quantile of a stream.  Five markers track
+ * the minimum, p/2, p, (1+p)/2 quantiles and the maximum; each sample
+ * moves the marker positions and adjusts the heights of the three middle
+ * ones with a piecewise-parabolic interpolation.  Exact below 5 samples.
+ */
+class P2Quantile
+{
+public:
+  explicit P2Quantile (double p = 0.5)
+    : m_p (p),
+      m_count (0)
+  {
+  }
+
+  void Add (double x)
+  {
+    if (m_count < 5)
+      {
+        m_q[m_count++] = x;
+        if (m_count == 5)
+          {
+            std::sort (m_q, m_q + 5);
+            for (int i = 0; i < 5; ++i)
+              {
+                m_n[i] = i;
+              }
+            m_want[0] = 0;
+            m_want[1] = 2 * m_p;
+            m_want[2] = 4 * m_p;
+            m_want[3] = 2 + 2 * m_p;
+            m_want[4] = 4;
+            m_step[0] = 0;
+            m_step[1] = m_p / 2;
+            m_step[2] = m_p;
+            m_step[3] = (1 + m_p) / 2;
+            m_step[4] = 1;
+          }
+        return;
+      }
+
+    // cell k such that m_q[k] <= x < m_q[k+1], extending the extremes
+    int k;
+    if (x < m_q[0])
+      {
+        m_q[0] = x;
+        k = 0;
+      }
+    else if (x >= m_q[4])
+      {
+        m_q[4] = x;
+        k = 3;
+      }
+    else
+      {
+        k = 0;
+        while (x >= m_q[k + 1])
+          {
+            k++;
+          }
+      }
+    for (int i = k + 1; i < 5; ++i)
+      {
+        m_n[i]++;
+      }
+    for (int i = 0; i < 5; ++i)
+      {
+        m_want[i] += m_step[i];
+      }
+
+    for (int i = 1; i < 4; ++i)
+      {
+        double d = m_want[i] - m_n[i];
+        if ((d >= 1 && m_n[i + 1] - m_n[i] > 1) || (d <= -1 && m_n[i - 1] - m_n[i] < -1))
+          {
+            int s = d > 0 ? 1 : -1;
+            double q = Parabolic (i, s);
+            m_q[i] = (m_q[i - 1] < q && q < m_q[i + 1]) ? q : Linear (i, s);
+            m_n[i] += s;
+          }
+      }
+    m_count++;
+  }
+
+  double Get (void) const
+  {
+    if (m_count >= 5)
+      {
+        return m_q[2];
+      }
+    if (m_count == 0)
+      {
+        return 0;
+      }
+    double sorted[5];
+    std::copy (m_q, m_q + m_count, sorted);
+    std::sort (sorted, sorted + m_count);
+    return sorted[static_cast<uint32_t> (m_p * (m_count - 1) + 0.5)];
+  }
+
+private:
+  double Parabolic (int i, int s) const
+  {
+    return m_q[i] + s / (m_n[i + 1] - m_n[i - 1])
+      * ((m_n[i] - m_n[i - 1] + s) * (m_q[i + 1] - m_q[i]) / (m_n[i + 1] - m_n[i])
+         + (m_n[i + 1] - m_n[i] - s) * (m_q[i] - m_q[i - 1]) / (m_n[i] - m_n[i - 1]));
+  }
+
+  double Linear (int i, int s) const
+  {
+    return m_q[i] + s * (m_q[i + s] - m_q[i]) / (m_n[i + s] - m_n[i]);
+  }
+
+  double m_p;
+  uint32_t m_count;
+  double m_q[5];    // marker heights
+  double m_n[5];    // marker positions
+  double m_want[5]; // desired positions
+  double m_step[5]; // desired position increments
+};
+
+// Streaming delay statistics of one flow, in seconds.
+struct DelayStats
+{
+  DelayStats ()
+    : count (0),
+      min (0),
+      max (0),
+      mean (0),
+      m2 (0),
+      jitterSum (0),
+      last (0),
+      p50 (0.50),
+      p95 (0.95),
+      p99 (0.99)
+  {
+  }
+
+  void Add (double d)
+  {
+    count++;
+    if (count == 1)
+      {
+        min = max = d;
+      }
+    else
+      {
+        min = std::min (min, d);
+        max = std::max (max, d);
+        jitterSum += std::fabs (d - last);
+      }
+    double delta = d - mean;
+    mean += delta / count;
+    m2 += delta * (d - mean);
+    last = d;
+    p50.Add (d);
+    p95.Add (d);
+    p99.Add (d);
+  }
+
+  double GetVariance (void) const
+  {
+    return count > 1 ? m2 / (count - 1) : 0;
+  }
+
+  double GetJitter (void) const
+  {
+    return count > 1 ? jitterSum / (count - 1) : 0;
+  }
+
+  uint64_t count;
+  double min;
+  double max;
+  double mean;
+  double m2;        // sum of squared deviations from the mean
+  double jitterSum;
+  double last;
+  P2Quantile p50;
+  P2Quantile p95;
+  P2Quantile p99;
+};
+
+class FlowDelayEstimator
+{
+public:
+  typedef std::map<Address, DelayStats>::const_iterator Iterator;
+
+  FlowDelayEstimator ()
+  {
+  }
+
+  // Stamp the send time on a packet about to be sent.
+  static void Stamp (Ptr<Packet> packet)
+  {
+    DelayTimestampTag tag;
+    packet->AddByteTag (tag);
+  }
+
+  /*
+   * Record the delay of a received packet under its source address; the
+   * signature matches the PacketSink "Rx" trace.  Packets without a
+   * timestamp are ignored.  Returns the delay, or zero.
+   */
+  Time Record (Ptr<const Packet> packet, const Address &from)
+  {
+    DelayTimestampTag tag;
+    if (!packet->FindFirstMatchingByteTag (tag))
+      {
+        return Time (0);
+      }
+    Time delay = Simulator::Now () - tag.GetTxTime ();
+    m_flows[from].Add (delay.GetSeconds ());
+    return delay;
+  }
+
+  const DelayStats *Find (const Address &from) const
+  {
+    Iterator it = m_flows.find (from);
+    return it == m_flows.end () ? 0 : &it->second;
+  }
+
+  Iterator Begin (void) const
+  {
+    return m_flows.begin ();
+  }
+
+  Iterator End (void) const
+  {
+    return m_flows.end ();
+  }
+
+  /*
+   * One line per flow, delays in ms:
+   *   <source> <packets> <mean> <stddev> <jitter> <min> <p50> <p95> <p99> <max>
+   */
+  void Print (std::ostream &os) const
+  {
+    os << "# source packets meanMs stddevMs jitterMs minMs p50Ms p95Ms p99Ms maxMs\n";
+    for (Iterator it = m_flows.begin (); it != m_flows.end (); ++it)
+      {
+        const DelayStats &s = it->second;
+        if (InetSocketAddress::IsMatchingType (it->first))
+          {
+            InetSocketAddress a = InetSocketAddress::ConvertFrom (it->first);
+            os << a.GetIpv4 () << ":" << a.GetPort ();
+          }
+        else
+          {
+            os << it->first;
+          }
+        os << " " << s.count
+           << " " << s.mean * 1000 << " " << std::sqrt (s.GetVariance ()) * 1000
+           << " " << s.GetJitter () * 1000 << " " << s.min * 1000
+           << " " << s.p50.Get () * 1000 << " " << s.p95.Get () * 1000
+           << " " << s.p99.Get () * 1000 << " " << s.max * 1000 << "\n";
+      }
+    os.flush ();
+  }
+
+private:
+  std::map<Address, DelayStats> m_flows;
+};
+
+} // namespace ns3
+
+#endif /* FLOW_DELAY_ESTIMATOR_H */
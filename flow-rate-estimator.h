@@ -0,0 +1,146 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Per-flow interval rates for the periodic monitors.
+ *
+ * rxBytes * 8 / (timeLastRxPacket - timeFirstTxPacket) is an average over
+ * the whole life of the flow: it hides bursts and is -0 until the first
+ * packet arrives.  FlowRateEstimator keeps the counters seen at the
+ * previous tick of each flow and returns what happened in between:
+ *
+ *   throughput  IP-level Mbps received during the interval
+ *   goodput     same, without 'headerBytes' of IP/transport headers per packet
+ *   lossRate    lost / (received + lost) packets during the interval
+ *
+ * FlowIds handed out by FlowMonitor are small consecutive integers, so the
+ * previous counters live in a vector indexed by FlowId and each update is
+ * O(1).
+ */
+
+#ifndef FLOW_RATE_ESTIMATOR_H
+#define FLOW_RATE_ESTIMATOR_H
+
+#include "ns3/core-module.h"
+#include "ns3/flow-monitor-module.h"
+
+#include <vector>
+
+namespace ns3 {
+
+struct FlowRate
+{
+  FlowRate ()
+    : interval (0),
+      throughput (0),
+      goodput (0),
+      lossRate (0)
+  {
+  }
+
+  double interval;   // seconds covered by this estimate
+  double throughput; // Mbps
+  double goodput;    // Mbps
+  double lossRate;   // 0..1
+};
+
+class FlowRateEstimator
+{
+public:
+  /*
+   * 'headerBytes' is the per-packet overhead counted by FlowMonitor but not
+   * by the application; 28 is IPv4 + UDP.
+   */
+  FlowRateEstimator (uint32_t headerBytes = 28)
+    : m_headerBytes (headerBytes)
+  {
+  }
+
+  FlowRate Update (FlowId flowId, const FlowMonitor::FlowStats &s)
+  {
+    return Update (flowId, s.timeFirstTxPacket, s.rxBytes, s.rxPackets, s.lostPackets);
+  }
+
+  /*
+   * Return the rates of one flow since its previous update and remember the
+   * current counters.  The first update of a flow measures from its first
+   * transmitted packet.
+   */
+  FlowRate Update (FlowId flowId, Time firstTx, uint64_t rxBytes, uint32_t rxPackets, uint32_t lostPackets)
+  {
+    if (flowId >= m_last.size ())
+      {
+        m_last.resize (flowId + 1);
+      }
+    Counters &last = m_last[flowId];
+    Time now = Simulator::Now ();
+    if (!last.seen)
+      {
+        last.time = firstTx;
+        last.seen = true;
+      }
+
+    FlowRate rate;
+    rate.interval = (now - last.time).GetSeconds ();
+    if (rate.interval > 0)
+      {
+        uint64_t bytes = rxBytes - last.rxBytes;
+        uint32_t packets = rxPackets - last.rxPackets;
+        uint64_t overhead = static_cast<uint64_t> (packets) * m_headerBytes;
+        rate.throughput = bytes * 8.0 / rate.interval / 1024 / 1024;
+        rate.goodput = (bytes > overhead ? bytes - overhead : 0) * 8.0 / rate.interval / 1024 / 1024;
+        // lostPackets can go up after the fact when CheckForLostPackets
+        // times a packet out, so only count increases
+        uint32_t lost = lostPackets > last.lostPackets ? lostPackets - last.lostPackets : 0;
+        if (packets + lost > 0)
+          {
+            rate.lossRate = lost / static_cast<double> (packets + lost);
+          }
+      }
+
+    last.time = now;
+    last.rxBytes = rxBytes;
+    last.rxPackets = rxPackets;
+    last.lostPackets = lostPackets;
+    return rate;
+  }
+
+private:
+  struct Counters
+  {
+    Counters ()
+      : rxBytes (0),
+        rxPackets (0),
+        lostPackets (0),
+        seen (false)
+    {
+    }
+
+    Time time;
+    uint64_t rxBytes;
+    uint32_t rxPackets;
+    uint32_t lostPackets;
+    bool seen;
+  };
+
+  uint32_t m_headerBytes;
+  std::vector<Counters> m_last;
+};
+
+} // namespace ns3
+
+#endif /* FLOW_RATE_ESTIMATOR_H */
@@ -0,0 +1,49 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Print the flow table recorded by FlowSnapshotWriter as it was at a
+ * given simulation time.
+ *
+ *  Usage:
+ *  ./waf --run "scratch/flow-snapshot-dump --file=./scratch/ThroughputMonitor.snap --time=40"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/flow-monitor-module.h"
+
+#include <iostream>
+#include <string>
+
+#include "flow-snapshot.h"
+
+using namespace ns3;
+
+int main (int argc, char *argv[])
+{
+  std::string fileName = "./scratch/ThroughputMonitor.snap";
+  double time = 1e9; // seconds, i.e. the last tick by default
+
+  CommandLine cmd;
+  cmd.AddValue ("file", "snapshot stream written by FlowSnapshotWriter", fileName);
+  cmd.AddValue ("time", "simulation time (seconds) to rebuild the flow table at", time);
+  cmd.Parse (argc, argv);
+
+  std::map<FlowId, FlowMonitor::FlowStats> stats;
+  Time tick = FlowSnapshotReader::Load (fileName, Seconds (time), stats);
+  if (tick.IsStrictlyNegative ())
+    {
+      std::cout << "No tick recorded at or before " << time << "s" << std::endl;
+      return 1;
+    }
+
+  std::cout << "Flow table at " << tick.GetSeconds () << "s" << std::endl;
+  for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator it = stats.begin (); it != stats.end (); ++it)
+    {
+      std::cout << "Flow ID: " << it->first
+                << "  Tx Packets = " << it->second.txPackets
+                << "  Rx Packets = " << it->second.rxPackets
+                << "  Lost Packets = " << it->second.lostPackets
+                << "  Rx Bytes = " << it->second.rxBytes << std::endl;
+    }
+
+  return 0;
+}
@@ -0,0 +1,394 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Incremental FlowMonitor snapshots.
+ *
+ * FlowMonitor::SerializeToXmlFile rewrites every flow, histogram and probe
+ * on each call, which is what the per-second ThroughputMonitor callbacks
+ * used to do.  FlowSnapshotWriter instead appends one tick to a text stream
+ * holding only the flows, histogram bins and drop counters that changed
+ * since the previous tick.  FlowSnapshotReader replays that stream and
+ * rebuilds the FlowMonitor::FlowStats map as it was at any tick.
+ *
+ * Stream format, one record per line:
+ *
+ *   T <now-ns>
+ *   F <flowId> <firstTx> <firstRx> <lastTx> <lastRx> <delaySum> <jitterSum>
+ *     <lastDelay> <txBytes> <rxBytes> <txPackets> <rxPackets> <lost> <fwd>
+ *   B <flowId> <d|j|s|i> <binWidth> <bin> <count>
+ *   D <flowId> <reason> <packets> <bytes>
+ *
+ * Times are in nanoseconds.  F, B and D records carry absolute values, so a
+ * reader only has to keep the latest record for each key.
+ *
+ * Header-only so that any scratch program can pick it up with
+ *   #include "flow-snapshot.h"
+ */
+
+#ifndef FLOW_SNAPSHOT_H
+#define FLOW_SNAPSHOT_H
+
+#include "ns3/core-module.h"
+#include "ns3/flow-monitor-module.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace ns3 {
+
+class FlowSnapshotWriter
+{
+public:
+  FlowSnapshotWriter ()
+  {
+  }
+
+  ~FlowSnapshotWriter ()
+  {
+    Close ();
+  }
+
+  void Open (std::string fileName)
+  {
+    Close ();
+    m_os.open (fileName.c_str (), std::ios::out | std::ios::trunc);
+    NS_ABORT_MSG_UNLESS (m_os.is_open (), "Can't open " << fileName);
+    m_last.clear ();
+  }
+
+  void Close (void)
+  {
+    if (m_os.is_open ())
+      {
+        m_os.close ();
+      }
+  }
+
+  /*
+   * Append the current state of the monitor as one tick.  Only the flows
+   * whose counters moved since the last call are written.
+   */
+  void Write (Ptr<FlowMonitor> monitor)
+  {
+    if (!m_os.is_open ())
+      {
+        return;
+      }
+    monitor->CheckForLostPackets ();
+    std::map<FlowId, FlowMonitor::FlowStats> stats = monitor->GetFlowStats ();
+    Write (stats);
+  }
+
+  /*
+   * Same, from stats already read this tick (FlowCounterTable::GetStats),
+   * so that the monitor is not copied twice.
+   */
+  void Write (std::map<FlowId, FlowMonitor::FlowStats> &stats)
+  {
+    if (!m_os.is_open ())
+      {
+        return;
+      }
+    m_os << "T " << Simulator::Now ().GetNanoSeconds () << "\n";
+    for (std::map<FlowId, FlowMonitor::FlowStats>::iterator it = stats.begin (); it != stats.end (); ++it)
+      {
+        WriteFlow (it->first, it->second, m_last[it->first]);
+      }
+    m_os.flush ();
+  }
+
+private:
+  struct FlowState
+  {
+    FlowState ()
+      : txPackets (0),
+        rxPackets (0),
+        lostPackets (0),
+        timesForwarded (0),
+        written (false)
+    {
+    }
+
+    uint32_t txPackets;
+    uint32_t rxPackets;
+    uint32_t lostPackets;
+    uint32_t timesForwarded;
+    bool written;
+    std::vector<uint32_t> bins[4];
+    std::vector<uint32_t> dropPackets;
+  };
+
+  void WriteFlow (FlowId id, FlowMonitor::FlowStats &s, FlowState &last)
+  {
+    // Every packet event moves at least one of these counters, so they are
+    // enough to tell whether the flow changed since the previous tick.
+    if (last.written
+        && last.txPackets == s.txPackets
+        && last.rxPackets == s.rxPackets
+        && last.lostPackets == s.lostPackets
+        && last.timesForwarded == s.timesForwarded
+        && last.dropPackets == s.packetsDropped)
+      {
+        return;
+      }
+
+    m_os << "F " << id
+         << " " << s.timeFirstTxPacket.GetNanoSeconds ()
+         << " " << s.timeFirstRxPacket.GetNanoSeconds ()
+         << " " << s.timeLastTxPacket.GetNanoSeconds ()
+         << " " << s.timeLastRxPacket.GetNanoSeconds ()
+         << " " << s.delaySum.GetNanoSeconds ()
+         << " " << s.jitterSum.GetNanoSeconds ()
+         << " " << s.lastDelay.GetNanoSeconds ()
+         << " " << s.txBytes
+         << " " << s.rxBytes
+         << " " << s.txPackets
+         << " " << s.rxPackets
+         << " " << s.lostPackets
+         << " " << s.timesForwarded
+         << "\n";
+
+    WriteBins (id, 'd', s.delayHistogram, last.bins[0]);
+    WriteBins (id, 'j', s.jitterHistogram, last.bins[1]);
+    WriteBins (id, 's', s.packetSizeHistogram, last.bins[2]);
+    WriteBins (id, 'i', s.flowInterruptionsHistogram, last.bins[3]);
+
+    for (uint32_t reason = 0; reason < s.packetsDropped.size (); ++reason)
+      {
+        uint32_t before = reason < last.dropPackets.size () ? last.dropPackets[reason] : 0;
+        if (s.packetsDropped[reason] != before)
+          {
+            m_os << "D " << id << " " << reason
+                 << " " << s.packetsDropped[reason]
+                 << " " << s.bytesDropped[reason] << "\n";
+          }
+      }
+
+    last.txPackets = s.txPackets;
+    last.rxPackets = s.rxPackets;
+    last.lostPackets = s.lostPackets;
+    last.timesForwarded = s.timesForwarded;
+    last.dropPackets = s.packetsDropped;
+    last.written = true;
+  }
+
+  // Histogram::GetBinCount is not const, hence the non-const reference.
+  void WriteBins (FlowId id, char tag, Histogram &h, std::vector<uint32_t> &last)
+  {
+    uint32_t nBins = h.GetNBins ();
+    if (last.size () < nBins)
+      {
+        last.resize (nBins, 0);
+      }
+    for (uint32_t bin = 0; bin < nBins; ++bin)
+      {
+        uint32_t count = h.GetBinCount (bin);
+        if (count != last[bin])
+          {
+            m_os << "B " << id << " " << tag << " " << h.GetBinWidth (bin)
+                 << " " << bin << " " << count << "\n";
+            last[bin] = count;
+          }
+      }
+  }
+
+  std::ofstream m_os;
+  std::map<FlowId, FlowState> m_last;
+};
+
+
+class FlowSnapshotReader
+{
+public:
+  /*
+   * Rebuild the flow table as it was at the last tick written at or before
+   * 'at'.  Returns the time of that tick, or -1 ns if the stream holds no
+   * tick that early.
+   */
+  static Time Load (std::string fileName, Time at, std::map<FlowId, FlowMonitor::FlowStats> &out)
+  {
+    std::ifstream is (fileName.c_str ());
+    NS_ABORT_MSG_UNLESS (is.is_open (), "Can't open " << fileName);
+
+    std::map<FlowId, FlowRecord> flows;
+    int64_t tick = -1;
+    std::string line;
+    while (std::getline (is, line))
+      {
+        std::istringstream iss (line);
+        char kind;
+        if (!(iss >> kind))
+          {
+            continue;
+          }
+        if (kind == 'T')
+          {
+            int64_t now;
+            iss >> now;
+            if (now > at.GetNanoSeconds ())
+              {
+                break;
+              }
+            tick = now;
+          }
+        else if (kind == 'F')
+          {
+            FlowId id;
+            iss >> id;
+            FlowRecord &r = flows[id];
+            for (int k = 0; k < 7; ++k)
+              {
+                iss >> r.times[k];
+              }
+            iss >> r.txBytes >> r.rxBytes >> r.txPackets >> r.rxPackets
+                >> r.lostPackets >> r.timesForwarded;
+          }
+        else if (kind == 'B')
+          {
+            FlowId id;
+            char tag;
+            double width;
+            uint32_t bin, count;
+            iss >> id >> tag >> width >> bin >> count;
+            FlowRecord &r = flows[id];
+            int h = HistogramIndex (tag);
+            r.binWidth[h] = width;
+            r.bins[h][bin] = count;
+          }
+        else if (kind == 'D')
+          {
+            FlowId id;
+            uint32_t reason, packets;
+            uint64_t bytes;
+            iss >> id >> reason >> packets >> bytes;
+            FlowRecord &r = flows[id];
+            if (r.packetsDropped.size () <= reason)
+              {
+                r.packetsDropped.resize (reason + 1, 0);
+                r.bytesDropped.resize (reason + 1, 0);
+              }
+            r.packetsDropped[reason] = packets;
+            r.bytesDropped[reason] = bytes;
+          }
+      }
+
+    out.clear ();
+    for (std::map<FlowId, FlowRecord>::const_iterator it = flows.begin (); it != flows.end (); ++it)
+      {
+        out[it->first] = it->second.ToFlowStats ();
+      }
+    return NanoSeconds (tick);
+  }
+
+private:
+  struct FlowRecord
+  {
+    FlowRecord ()
+      : txBytes (0),
+        rxBytes (0),
+        txPackets (0),
+        rxPackets (0),
+        lostPackets (0),
+        timesForwarded (0)
+    {
+      for (int k = 0; k < 7; ++k)
+        {
+          times[k] = 0;
+        }
+      for (int h = 0; h < 4; ++h)
+        {
+          binWidth[h] = 0;
+        }
+    }
+
+    FlowMonitor::FlowStats ToFlowStats (void) const
+    {
+      FlowMonitor::FlowStats s;
+      s.timeFirstTxPacket = NanoSeconds (times[0]);
+      s.timeFirstRxPacket = NanoSeconds (times[1]);
+      s.timeLastTxPacket = NanoSeconds (times[2]);
+      s.timeLastRxPacket = NanoSeconds (times[3]);
+      s.delaySum = NanoSeconds (times[4]);
+      s.jitterSum = NanoSeconds (times[5]);
+      s.lastDelay = NanoSeconds (times[6]);
+      s.txBytes = txBytes;
+      s.rxBytes = rxBytes;
+      s.txPackets = txPackets;
+      s.rxPackets = rxPackets;
+      s.lostPackets = lostPackets;
+      s.timesForwarded = timesForwarded;
+      s.packetsDropped = packetsDropped;
+      s.bytesDropped = bytesDropped;
+      FillHistogram (s.delayHistogram, 0);
+      FillHistogram (s.jitterHistogram, 1);
+      FillHistogram (s.packetSizeHistogram, 2);
+      FillHistogram (s.flowInterruptionsHistogram, 3);
+      return s;
+    }
+
+    // Histogram has no setter for bin counts, so replay one value at the
+    // centre of the bin per recorded sample.
+    void FillHistogram (Histogram &h, int index) const
+    {
+      if (binWidth[index] <= 0)
+        {
+          return;
+        }
+      h.SetDefaultBinWidth (binWidth[index]);
+      for (std::map<uint32_t, uint32_t>::const_iterator it = bins[index].begin ();
+           it != bins[index].end (); ++it)
+        {
+          double centre = (it->first + 0.5) * binWidth[index];
+          for (uint32_t n = 0; n < it->second; ++n)
+            {
+              h.AddValue (centre);
+            }
+        }
+    }
+
+    int64_t times[7];
+    uint64_t txBytes;
+    uint64_t rxBytes;
+    uint32_t txPackets;
+    uint32_t rxPackets;
+    uint32_t lostPackets;
+    uint32_t timesForwarded;
+    double binWidth[4];
+    std::map<uint32_t, uint32_t> bins[4];
+    std::vector<uint32_t> packetsDropped;
+    std::vector<uint64_t> bytesDropped;
+  };
+
+  static int HistogramIndex (char tag)
+  {
+    switch (tag)
+      {
+      case 'd': return 0;
+      case 'j': return 1;
+      case 's': return 2;
+      default: return 3;
+      }
+  }
+};
+
+} // namespace ns3
+
+#endif /* FLOW_SNAPSHOT_H */
@@ -0,0 +1,118 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * End-of-run FlowMonitor summary for sweep.py.
+ *
+ * FlowSummary::Write dumps one CSV row per flow:
+ *
+ *   flowId,src,srcPort,dst,dstPort,protocol,txPackets,rxPackets,
+ *   lostPackets,txBytes,rxBytes,durationS,throughputKbps,meanDelayMs,
+ *   meanJitterMs
+ *
+ * throughputKbps is rxBytes * 8 / (timeLastRxPacket - timeFirstTxPacket)
+ * / 1024, as printed by the scripts, and 0 for flows that received
+ * nothing.
+ *
+ * OutputPrefix names the other files of a run after its summary.
+ */
+
+#ifndef FLOW_SUMMARY_H
+#define FLOW_SUMMARY_H
+
+#include "ns3/core-module.h"
+#include "ns3/flow-monitor-module.h"
+
+#include <fstream>
+#include <string>
+#include <map>
+
+namespace ns3 {
+
+class FlowSummary
+{
+public:
+  /*
+   * Prefix of the other files a run writes: 'fallback' for a run on its
+   * own, and the summary's name without ".csv" plus "-" under sweep.py,
+   * so that runs in parallel do not write over each other's files.
+   */
+  static std::string OutputPrefix (std::string summary, std::string fallback)
+  {
+    if (summary.empty ())
+      {
+        return fallback;
+      }
+    std::string::size_type n = summary.size ();
+    if (n > 4 && summary.compare (n - 4, 4, ".csv") == 0)
+      {
+        summary.erase (n - 4);
+      }
+    return summary + "-";
+  }
+
+  static void Write (Ptr<FlowMonitor> monitor, FlowMonitorHelper &helper, std::string fileName)
+  {
+    std::ofstream os (fileName.c_str ());
+    NS_ABORT_MSG_UNLESS (os.is_open (), "Can't open " << fileName);
+    Write (monitor, helper, os);
+  }
+
+  static void Write (Ptr<FlowMonitor> monitor, FlowMonitorHelper &helper, std::ostream &os)
+  {
+    Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier> (helper.GetClassifier ());
+
+    monitor->CheckForLostPackets ();
+    std::map<FlowId, FlowMonitor::FlowStats> stats = monitor->GetFlowStats ();
+    os << "flowId,src,srcPort,dst,dstPort,protocol,txPackets,rxPackets,lostPackets,"
+       << "txBytes,rxBytes,durationS,throughputKbps,meanDelayMs,meanJitterMs\n";
+    for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator it = stats.begin (); it != stats.end (); ++it)
+      {
+        const FlowMonitor::FlowStats &s = it->second;
+        Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow (it->first);
+        double duration = 0;
+        double throughput = 0;
+        double delay = 0;
+        double jitter = 0;
+        if (s.rxPackets > 0)
+          {
+            duration = (s.timeLastRxPacket - s.timeFirstTxPacket).GetSeconds ();
+            if (duration > 0)
+              {
+                throughput = s.rxBytes * 8.0 / duration / 1024;
+              }
+            delay = s.delaySum.GetSeconds () * 1000 / s.rxPackets;
+          }
+        if (s.rxPackets > 1)
+          {
+            jitter = s.jitterSum.GetSeconds () * 1000 / (s.rxPackets - 1);
+          }
+        os << it->first
+           << "," << t.sourceAddress << "," << t.sourcePort
+           << "," << t.destinationAddress << "," << t.destinationPort
+           << "," << static_cast<uint32_t> (t.protocol)
+           << "," << s.txPackets << "," << s.rxPackets << "," << s.lostPackets
+           << "," << s.txBytes << "," << s.rxBytes
+           << "," << duration << "," << throughput << "," << delay << "," << jitter
+           << "\n";
+      }
+  }
+};
+
+} // namespace ns3
+
+#endif /* FLOW_SUMMARY_H */
@@ -0,0 +1,442 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Spectrum channel that only delivers a transmission to nearby PHYs.
+ *
+ * YansWifiChannel::Send computes the loss to every other PHY and schedules
+ * one reception event per PHY, even for those so far away that the PHY
+ * drops the frame as below its EnergyDetectionThreshold.  That is O(N)
+ * events per frame and O(N^2) per broadcast round (OLSR HELLOs).
+ * YansWifiChannel::Send is not virtual, so the culling is done on the
+ * SpectrumChannel side instead, for SpectrumWifiPhy
+ * (SpectrumWifiPhyHelper::SetChannel).
+ *
+ * GridSpectrumChannel keeps the receivers in a uniform grid of square
+ * cells, one cut-off radius wide.  A transmission is offered only to the
+ * PHYs of the sender's cell and its eight neighbours.  Among those, it is
+ * dropped for PHYs whose path loss exceeds MaxLossDb (see GetMaxLossDb:
+ * TxPower + TxGain + RxGain - EnergyDetectionThreshold, plus a margin).
+ * The cut-off radius is the distance
+ * at which the propagation loss model reaches MaxLossDb.  It is found by
+ * probing the model, so the model must be deterministic and monotonic
+ * in distance (Friis, LogDistance, ...).  Otherwise set CellSize.
+ *
+ * The grid is built at the first transmission, after mobility is
+ * installed.  Nodes that report a CourseChange with a non-zero velocity
+ * are re-binned at each transmission until they stop.  Static grids are
+ * binned exactly once.
+ *
+ * A culled signal is gone for the PHY altogether: it is not received,
+ * and it is not added to the interference of the frames the PHY is
+ * receiving either, so their SINR comes out higher than on an unculled
+ * channel.  The margin bounds that error: every signal dropped is at least
+ * that far below the ED threshold.  Many weak interferers can still add
+ * up, so use a wider margin when SINR-limited results matter.
+ *
+ * With MaxLossDb left at its default, nothing is culled and every PHY
+ * gets every transmission, as on SingleModelSpectrumChannel.
+ *
+ * Usage:
+ *   Ptr<GridSpectrumChannel> channel = CreateObject<GridSpectrumChannel> ();
+ *   channel->AddPropagationLossModel (CreateObject<FriisPropagationLossModel> ());
+ *   channel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+ *   channel->SetAttribute ("MaxLossDb", DoubleValue (GridSpectrumChannel::GetMaxLossDb (5, 1, 1, -83.0, 10)));
+ *   SpectrumWifiPhyHelper phy = SpectrumWifiPhyHelper::Default ();
+ *   phy.SetChannel (channel);
+ */
+
+#ifndef GRID_SPECTRUM_CHANNEL_H
+#define GRID_SPECTRUM_CHANNEL_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-module.h"
+#include "ns3/spectrum-module.h"
+
+#include "trace-binder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <map>
+
+namespace ns3 {
+
+class GridSpectrumChannel : public SpectrumChannel
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::GridSpectrumChannel")
+      .SetParent<SpectrumChannel> ()
+      .AddConstructor<GridSpectrumChannel> ()
+      .AddAttribute ("MaxLossDb",
+                     "Receivers with a larger path loss are not offered the signal.",
+                     DoubleValue (1.0e9),
+                     MakeDoubleAccessor (&GridSpectrumChannel::m_maxLossDb),
+                     MakeDoubleChecker<double> ())
+      .AddAttribute ("CellSize",
+                     "Side of the grid cells (m); 0 derives it from MaxLossDb.",
+                     DoubleValue (0.0),
+                     MakeDoubleAccessor (&GridSpectrumChannel::m_cellSize),
+                     MakeDoubleChecker<double> (0.0))
+    ;
+    return tid;
+  }
+
+  /*
+   * Path loss beyond which a PHY cannot detect a frame, plus 'marginDb' so
+   * that signals just below the ED threshold still interfere.  The gains
+   * are WifiPhy's TxGain and RxGain (1 dB each by default).
+   */
+  static double GetMaxLossDb (double txPowerDbm, double txGainDb, double rxGainDb,
+                              double edThresholdDbm, double marginDb)
+  {
+    return txPowerDbm + txGainDb + rxGainDb - edThresholdDbm + marginDb;
+  }
+
+  GridSpectrumChannel ()
+    : m_maxLossDb (1.0e9),
+      m_cellSize (0.0),
+      m_indexed (false),
+      m_culled (0)
+  {
+  }
+
+  virtual ~GridSpectrumChannel ()
+  {
+  }
+
+  virtual void AddPropagationLossModel (Ptr<PropagationLossModel> loss)
+  {
+    NS_ABORT_MSG_UNLESS (m_loss == 0, "GridSpectrumChannel takes one propagation loss model");
+    m_loss = loss;
+  }
+
+  virtual void AddSpectrumPropagationLossModel (Ptr<SpectrumPropagationLossModel> loss)
+  {
+    NS_ABORT_MSG_UNLESS (m_spectrumLoss == 0, "GridSpectrumChannel takes one spectrum loss model");
+    m_spectrumLoss = loss;
+  }
+
+  virtual void SetPropagationDelayModel (Ptr<PropagationDelayModel> delay)
+  {
+    m_delay = delay;
+  }
+
+  Ptr<SpectrumPropagationLossModel> GetSpectrumPropagationLossModel (void)
+  {
+    return m_spectrumLoss;
+  }
+
+  virtual void AddRx (Ptr<SpectrumPhy> phy)
+  {
+    m_entries.Add (Entry (this, m_entries.GetN (), phy));
+    m_indexed = false;
+  }
+
+  virtual void StartTx (Ptr<SpectrumSignalParameters> txParams)
+  {
+    Ptr<MobilityModel> senderMobility = txParams->txPhy->GetMobility ();
+    if (!Culling () || senderMobility == 0)
+      {
+        for (TraceSinks<Entry>::Iterator e = m_entries.Begin (); e != m_entries.End (); ++e)
+          {
+            Offer (txParams, senderMobility, *e);
+          }
+        return;
+      }
+
+    if (!m_indexed)
+      {
+        BuildIndex ();
+      }
+    Rebin ();
+    Cell c = CellOf (senderMobility->GetPosition ());
+    for (int64_t dx = -1; dx <= 1; ++dx)
+      {
+        for (int64_t dy = -1; dy <= 1; ++dy)
+          {
+            std::map<Cell, std::vector<uint32_t> >::const_iterator cell =
+              m_cells.find (Cell (c.first + dx, c.second + dy));
+            if (cell == m_cells.end ())
+              {
+                continue;
+              }
+            for (std::vector<uint32_t>::const_iterator k = cell->second.begin (); k != cell->second.end (); ++k)
+              {
+                Offer (txParams, senderMobility, m_entries.Get (*k));
+              }
+          }
+      }
+    for (std::vector<uint32_t>::const_iterator k = m_unplaced.begin (); k != m_unplaced.end (); ++k)
+      {
+        Offer (txParams, senderMobility, m_entries.Get (*k));
+      }
+  }
+
+  virtual uint32_t GetNDevices (void) const
+  {
+    return m_entries.GetN ();
+  }
+
+  virtual Ptr<NetDevice> GetDevice (uint32_t i) const
+  {
+    return m_entries.Get (i).phy->GetDevice ();
+  }
+
+  // Receptions skipped so far because of MaxLossDb (not counting the
+  // PHYs outside the neighbouring cells, which are never looked at).
+  uint64_t GetCulled (void) const
+  {
+    return m_culled;
+  }
+
+  double GetCellSize (void) const
+  {
+    return m_cellSize;
+  }
+
+protected:
+  virtual void DoDispose (void)
+  {
+    m_entries.Clear ();
+    m_cells.clear ();
+    m_loss = 0;
+    m_spectrumLoss = 0;
+    m_delay = 0;
+    SpectrumChannel::DoDispose ();
+  }
+
+private:
+  typedef std::pair<int64_t, int64_t> Cell;
+
+  struct Entry
+  {
+    Entry (GridSpectrumChannel *ch, uint32_t i, Ptr<SpectrumPhy> p)
+      : channel (ch),
+        index (i),
+        phy (p),
+        cell (0, 0),
+        placed (false),
+        mobile (false)
+    {
+    }
+
+    GridSpectrumChannel *channel;
+    uint32_t index;
+    Ptr<SpectrumPhy> phy;
+    Ptr<MobilityModel> mobility;
+    Cell cell;
+    bool placed;
+    bool mobile;            // queued in m_mobile
+  };
+
+  bool Culling (void) const
+  {
+    return m_loss != 0 && m_maxLossDb < 1.0e9;
+  }
+
+  void Offer (Ptr<SpectrumSignalParameters> txParams, Ptr<MobilityModel> senderMobility, Entry &e)
+  {
+    if (e.phy == txParams->txPhy)
+      {
+        return;
+      }
+    Ptr<SpectrumSignalParameters> rxParams = txParams->Copy ();
+    Time delay = MicroSeconds (0);
+    Ptr<MobilityModel> receiverMobility = e.phy->GetMobility ();
+    if (senderMobility != 0 && receiverMobility != 0)
+      {
+        if (m_loss != 0)
+          {
+            double gainDb = m_loss->CalcRxPower (0, senderMobility, receiverMobility);
+            if (-gainDb > m_maxLossDb)
+              {
+                m_culled++;
+                return;
+              }
+            *(rxParams->psd) *= std::pow (10.0, gainDb / 10.0);
+          }
+        if (m_spectrumLoss != 0)
+          {
+            rxParams->psd = m_spectrumLoss->CalcRxPowerSpectralDensity (rxParams->psd, senderMobility, receiverMobility);
+          }
+        if (m_delay != 0)
+          {
+            delay = m_delay->GetDelay (senderMobility, receiverMobility);
+          }
+      }
+    Ptr<NetDevice> device = e.phy->GetDevice ();
+    uint32_t context = device != 0 ? device->GetNode ()->GetId () : Simulator::NO_CONTEXT;
+    Simulator::ScheduleWithContext (context, delay, &GridSpectrumChannel::StartRx, rxParams, e.phy);
+  }
+
+  static void StartRx (Ptr<SpectrumSignalParameters> params, Ptr<SpectrumPhy> receiver)
+  {
+    receiver->StartRx (params);
+  }
+
+  Cell CellOf (const Vector &p) const
+  {
+    return Cell (static_cast<int64_t> (std::floor (p.x / m_cellSize)),
+                 static_cast<int64_t> (std::floor (p.y / m_cellSize)));
+  }
+
+  /*
+   * Distance at which the loss model reaches MaxLossDb, probed between two
+   * fixed positions: doubling up to the first distance beyond the cut-off,
+   * then bisection.  Slightly rounded up so the neighbouring cells always
+   * cover the cut-off radius.
+   */
+  double CutOffRadius (void) const
+  {
+    Ptr<ConstantPositionMobilityModel> a = CreateObject<ConstantPositionMobilityModel> ();
+    Ptr<ConstantPositionMobilityModel> b = CreateObject<ConstantPositionMobilityModel> ();
+    a->SetPosition (Vector (0, 0, 0));
+    double near = 0;
+    double far = 1;
+    for (b->SetPosition (Vector (far, 0, 0)); -m_loss->CalcRxPower (0, a, b) <= m_maxLossDb;
+         b->SetPosition (Vector (far, 0, 0)))
+      {
+        near = far;
+        far *= 2;
+        NS_ABORT_MSG_UNLESS (far < 1.0e7, "MaxLossDb is not reached within 10000 km; set CellSize");
+      }
+    for (int i = 0; i < 40; ++i)
+      {
+        double mid = (near + far) / 2;
+        b->SetPosition (Vector (mid, 0, 0));
+        if (-m_loss->CalcRxPower (0, a, b) <= m_maxLossDb)
+          {
+            near = mid;
+          }
+        else
+          {
+            far = mid;
+          }
+      }
+    return far * 1.001;
+  }
+
+  void BuildIndex (void)
+  {
+    if (m_cellSize <= 0)
+      {
+        m_cellSize = CutOffRadius ();
+      }
+    m_cells.clear ();
+    m_unplaced.clear ();
+    m_mobile.clear ();
+    for (TraceSinks<Entry>::Iterator e = m_entries.Begin (); e != m_entries.End (); ++e)
+      {
+        e->placed = false;
+        e->mobile = false;
+        Ptr<MobilityModel> mobility = e->phy->GetMobility ();
+        if (mobility == 0)
+          {
+            m_unplaced.push_back (e->index);
+            continue;
+          }
+        if (e->mobility != mobility)
+          {
+            e->mobility = mobility;
+            m_entries.Connect (mobility, "CourseChange", &GridSpectrumChannel::CourseChanged, &*e);
+          }
+        Place (*e);
+        Vector v = mobility->GetVelocity ();
+        if (v.x != 0 || v.y != 0 || v.z != 0)
+          {
+            e->mobile = true;
+            m_mobile.push_back (e->index);
+          }
+      }
+    m_indexed = true;
+  }
+
+  void Place (Entry &e)
+  {
+    Cell cell = CellOf (e.mobility->GetPosition ());
+    if (e.placed)
+      {
+        if (cell == e.cell)
+          {
+            return;
+          }
+        std::vector<uint32_t> &old = m_cells[e.cell];
+        *std::find (old.begin (), old.end (), e.index) = old.back ();
+        old.pop_back ();
+      }
+    e.cell = cell;
+    e.placed = true;
+    m_cells[cell].push_back (e.index);
+  }
+
+  // Move the nodes in motion to their current cell; drop those that stopped.
+  void Rebin (void)
+  {
+    for (uint32_t k = 0; k < m_mobile.size (); )
+      {
+        Entry &e = m_entries.Get (m_mobile[k]);
+        Place (e);
+        Vector v = e.mobility->GetVelocity ();
+        if (v.x == 0 && v.y == 0 && v.z == 0)
+          {
+            e.mobile = false;
+            m_mobile[k] = m_mobile.back ();
+            m_mobile.pop_back ();
+          }
+        else
+          {
+            ++k;
+          }
+      }
+  }
+
+  static void CourseChanged (Entry *e, Ptr<const MobilityModel> mobility)
+  {
+    if (!e->channel->m_indexed)
+      {
+        return;
+      }
+    // re-bin now, and at every transmission while it keeps moving
+    e->channel->Place (*e);
+    if (!e->mobile)
+      {
+        e->mobile = true;
+        e->channel->m_mobile.push_back (e->index);
+      }
+  }
+
+  double m_maxLossDb;
+  double m_cellSize;
+  Ptr<PropagationLossModel> m_loss;
+  Ptr<SpectrumPropagationLossModel> m_spectrumLoss;
+  Ptr<PropagationDelayModel> m_delay;
+  TraceSinks<Entry> m_entries;
+  std::map<Cell, std::vector<uint32_t> > m_cells;
+  std::vector<uint32_t> m_unplaced;  // PHYs without a mobility model
+  std::vector<uint32_t> m_mobile;    // entries moving since they were last placed
+  bool m_indexed;
+  uint64_t m_culled;
+};
+
+} // namespace ns3
+
+#endif /* GRID_SPECTRUM_CHANNEL_H */
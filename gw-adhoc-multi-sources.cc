@@ -108,6 +108,9 @@
 #include <vector>
 #include <string>
 
+#include "batch-traffic-generator.h"
+#include "trace-binder.h"
+
 using namespace ns3;
 using namespace std;
 
@@ -121,46 +124,20 @@ void SocketReceivePacket (Ptr<Socket> socket)
  //   }
 }
 
-void Tx(std::string context, Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+void Tx(TraceId id, Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
 {
-    // std::cout<<context;
+    // std::cout<<id;
     std::cout<<Simulator::Now().As(Time::S)<<" ";
     std::cout<<ipv4->GetAddress(1,0).GetLocal()<<" send a packet!"<<std::endl;
 }
 
-void Rx(std::string context, Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+void Rx(TraceId id, Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
 {
-    // std::cout<<context;
+    // std::cout<<id;
     std::cout<<Simulator::Now().As(Time::S)<<" ";
     std::cout<<ipv4->GetAddress(1,0).GetLocal()<<" recv a packet!"<<std::endl;
 }
 
-static void GenerateTraffic (std::vector< Ptr<Socket> > sources, uint32_t pktSize, 
-                             uint32_t pktCount, Time pktInterval )
-{
-  // cout<<sources.size()<<endl;
-  if (pktCount > 0)
-    {
-      for(std::vector< Ptr<Socket> >::iterator socket=sources.begin(); socket!=sources.end(); ++socket){
-        int sendbytes = (*socket)->Send (Create<Packet> (pktSize));
-        //sendCb(socket, socket->GetTxAvailable());
-        // std::cout<<"Send "<<sendbytes<<" bytes!"<<std::endl;
-      } 
-      Simulator::Schedule (pktInterval, &GenerateTraffic, 
-                           sources, pktSize,pktCount-1, pktInterval);
-    }
-  else
-    {
-      std::vector< Ptr<Socket> >::iterator socket = sources.begin();
-      while(socket != sources.end()){
-        (*socket)->Close ();  
-        socket++;
-      }
-      
-    }
-}
-
-
 int main (int argc, char *argv[])
 {
     LogComponentEnable("WifiSimpleAdhocGrid", LOG_LEVEL_INFO);
@@ -293,14 +270,16 @@ int main (int argc, char *argv[])
 
   // create the sources, number indicates the node's id
   int sourceNodeArray[] = {0, 3, 12, 15};
-  std::vector< Ptr<Socket> > sources;
+  // one generator, one event per interval for all the sources; it runs on
+  // the first source and sends on the others in their own node's context
+  Ptr<BatchTrafficGenerator> traffic = CreateObject<BatchTrafficGenerator> ();
   for(int i=0; i<numSource; ++i)
   {
     // cout<<i<<endl;
     Ptr<Socket> source = Socket::CreateSocket (sta_nc.Get (sourceNodeArray[i]), tid);
     InetSocketAddress remote = InetSocketAddress (ipv4Intf.GetAddress (numStaNodes, 0), 80);
     source->Connect (remote);
-    sources.push_back(source);
+    traffic->AddSource (source, packetSize, numPackets, interPacketInterval);
   }
 
   if (tracing == true)
@@ -320,21 +299,17 @@ int main (int argc, char *argv[])
     }
 
   // Give OLSR time to converge-- 30 seconds perhaps
-  Simulator::Schedule (Seconds (routeTime), &GenerateTraffic, 
-                       sources, packetSize, numPackets, interPacketInterval);
+  sta_nc.Get (sourceNodeArray[0])->AddApplication (traffic);
+  traffic->SetStartTime (Seconds (routeTime));
 
   // Output the xml file
   AnimationInterface anim("./xml/gw-adhoc.xml");
 
-  std::ostringstream oss;
-  oss << "/NodeList/0/$ns3::Ipv4L3Protocol/Tx";
-  // Config::ConnectWithoutContext(oss.str(), MakeCallback(&Tx));
-  Config::Connect(oss.str(), MakeCallback(&Tx));
-
-  // oss.clear();
-  oss.str("");
-  oss << "/NodeList/16/$ns3::Ipv4L3Protocol/Rx";
-  Config::Connect(oss.str(), MakeCallback(&Rx));
+  // bind straight to the nodes' Ipv4L3Protocol, no path parsing and no
+  // context string per packet
+  TraceBinder binder;
+  binder.ConnectNodesWithId<Ipv4L3Protocol> (NodeContainer (NodeList::GetNode (0)), "Tx", &Tx);
+  binder.ConnectNodesWithId<Ipv4L3Protocol> (NodeContainer (NodeList::GetNode (16)), "Rx", &Rx);
 
   // Output what we are doing
   NS_LOG_UNCOND ("Testing from node " << sourceNode << " to " << numStaNodes << " with grid distance " << distance);
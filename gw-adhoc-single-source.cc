@@ -108,6 +108,8 @@
 #include <vector>
 #include <string>
 
+#include "trace-binder.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("WifiSimpleAdhocGrid");
@@ -120,16 +122,16 @@ void SocketReceivePacket (Ptr<Socket> socket)
  //   }
 }
 
-void Tx(std::string context, Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+void Tx(TraceId id, Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
 {
-    // std::cout<<context;
+    // std::cout<<id;
     std::cout<<Simulator::Now().As(Time::S)<<" ";
     std::cout<<ipv4->GetAddress(1,0).GetLocal()<<" send a packet!"<<std::endl;
 }
 
-void Rx(std::string context, Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+void Rx(TraceId id, Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
 {
-    // std::cout<<context;
+    // std::cout<<id;
     std::cout<<Simulator::Now().As(Time::S)<<" ";
     std::cout<<ipv4->GetAddress(1,0).GetLocal()<<" recv a packet!"<<std::endl;
 }
@@ -308,15 +310,11 @@ int main (int argc, char *argv[])
   // Output the xml file
   AnimationInterface anim("./xml/gw-adhoc.xml");
 
-  std::ostringstream oss;
-  oss << "/NodeList/0/$ns3::Ipv4L3Protocol/Tx";
-  // Config::ConnectWithoutContext(oss.str(), MakeCallback(&Tx));
-  Config::Connect(oss.str(), MakeCallback(&Tx));
-
-  // oss.clear();
-  oss.str("");
-  oss << "/NodeList/16/$ns3::Ipv4L3Protocol/Rx";
-  Config::Connect(oss.str(), MakeCallback(&Rx));
+  // bind straight to the nodes' Ipv4L3Protocol, no path parsing and no
+  // context string per packet
+  TraceBinder binder;
+  binder.ConnectNodesWithId<Ipv4L3Protocol> (NodeContainer (NodeList::GetNode (0)), "Tx", &Tx);
+  binder.ConnectNodesWithId<Ipv4L3Protocol> (NodeContainer (NodeList::GetNode (16)), "Rx", &Rx);
 
   // Output what we are doing
   NS_LOG_UNCOND ("Testing from node " << sourceNode << " to " << numStaNodes << " with grid distance " << distance);
@@ -67,20 +67,32 @@
 #include <vector>
 #include <string>
 
+#include "flow-snapshot.h"
+#include "throughput-series.h"
+#include "flow-rate-estimator.h"
+#include "flow-counters.h"
+#include "batch-traffic-generator.h"
+#include "flow-summary.h"
+#include "grid-spectrum-channel.h"
+#include "route-journal.h"
+#include "convergence-monitor.h"
+
 using namespace ns3;
 
 int counter = 0;
-int m_sent = 0;
 
 NS_LOG_COMPONENT_DEFINE ("WifiSimpleAdhocGrid");
 
-void ThroughputMonitor (FlowMonitorHelper *fmhelper, Ptr<FlowMonitor> flowMon,Gnuplot2dDataset DataSet)
+void ThroughputMonitor (FlowMonitorHelper *fmhelper, Ptr<FlowMonitor> flowMon,ThroughputSeries *series,
+                        FlowSnapshotWriter *snapshot, FlowRateEstimator *rates,
+                        FlowCounterTable *counters)
 {
-	double localThrou=0;
-	std::map<FlowId, FlowMonitor::FlowStats> flowStats = flowMon->GetFlowStats();
 	Ptr<Ipv4FlowClassifier> classing = DynamicCast<Ipv4FlowClassifier> (fmhelper->GetClassifier());
-	for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator stats = flowStats.begin (); stats != flowStats.end (); ++stats)
+	// one GetFlowStats copy per tick, shared with the snapshot below
+	counters->Update (flowMon);
+	for (FlowCounterTable::Iterator stats = counters->Begin (); stats != counters->End (); ++stats)
 	{
+		FlowId flowId = stats->first;
 		//Ipv4FlowClassifier::FiveTuple fiveTuple = classing->FindFlow (stats->first);
 		//std::cout<<"Flow ID			: " << stats->first <<" ; "<< fiveTuple.sourceAddress <<" -----> "<<fiveTuple.destinationAddress<<std::endl;
 		//std::cout<<"Tx Packets = " << stats->second.txPackets<<std::endl;
@@ -88,18 +100,20 @@ void ThroughputMonitor (FlowMonitorHelper *fmhelper, Ptr<FlowMonitor> flowMon,Gn
 		//std::cout<<"Duration		: "<<(stats->second.timeLastRxPacket.GetSeconds()-stats->second.timeFirstTxPacket.GetSeconds())<<std::endl;
 		//std::cout<<"Last Received Packet	: "<< stats->second.timeLastRxPacket.GetSeconds()<<" Seconds"<<std::endl;
 		//std::cout<<"Throughput: " << stats->second.rxBytes * 8.0 / (stats->second.timeLastRxPacket.GetSeconds()-stats->second.timeFirstTxPacket.GetSeconds())/1024/1024  << " Mbps"<<std::endl;
-		localThrou=(stats->second.rxBytes * 8.0 / (stats->second.timeLastRxPacket.GetSeconds()-stats->second.timeFirstTxPacket.GetSeconds())/1024/1024);
-		// updata gnuplot data
-		DataSet.Add((double)Simulator::Now().GetSeconds(),(double) localThrou);
+		// idle flows are stored at the start and end of the idle period only
+		series->Sample (flowId, stats->second.rxBytes, stats->second.rxPackets);
+		// rates over the last tick only, not since the first packet
+		FlowRate rate = rates->Update (flowId, stats->second);
+		NS_LOG_INFO ("Flow " << flowId << " at " << Simulator::Now ().GetSeconds ()
+		             << "s: throughput " << rate.throughput << " Mbps, goodput " << rate.goodput
+		             << " Mbps, loss " << rate.lossRate);
 		//std::cout<<"---------------------------------------------------------------------------"<<std::endl;
 	}
 	
-	Simulator::Schedule(Seconds(1),&ThroughputMonitor, fmhelper, flowMon,DataSet);
+	Simulator::Schedule(Seconds(1),&ThroughputMonitor, fmhelper, flowMon,series, snapshot, rates, counters);
 	
-	//if(flowToXml)
-	//{
-	flowMon->SerializeToXmlFile ("./scratch/ThroughputMonitor.xml", true, true);
-	//}
+	// append only the flows that changed since the last tick
+	snapshot->Write (counters->GetStats ());
 
 }
 
@@ -112,29 +126,15 @@ void ReceivePacket (Ptr<Socket> socket)
     }
 }
 
-static void GenerateTraffic (Ptr<Socket> socket, uint32_t pktSize, 
-                             uint32_t pktCount, Time pktInterval )
+// Start the traffic once the routes have converged, keeping the time the
+// run had after the fixed start
+void StartTraffic (Ptr<BatchTrafficGenerator> traffic, Time tail)
 {
-  SeqTsHeader seqTs;
-  seqTs.SetSeq (m_sent);
-  Ptr<Packet> p = Create<Packet> (pktSize);
-  p->AddHeader (seqTs);
-  
-  if (pktCount > 0)
-    {
-      //socket->Send (Create<Packet> (pktSize));
-      socket->Send (p);
-      ++m_sent;
-      Simulator::Schedule (pktInterval, &GenerateTraffic, 
-                           socket, pktSize,pktCount-1, pktInterval);
-    }
-  else
-    {
-      socket->Close ();
-    }
+  NS_LOG_UNCOND ("Routes converged at " << Simulator::Now ().GetSeconds () << " s");
+  traffic->StartNow ();
+  Simulator::Stop (tail);
 }
 
-
 int main (int argc, char *argv[])
 {
   //std::string phyMode ("DsssRate1Mbps");
@@ -146,6 +146,10 @@ int main (int argc, char *argv[])
   double interval = 0.10; // seconds
   bool verbose = false;
   bool tracing = true;
+  uint32_t rtsCtsThreshold = 2200;
+  std::string summary = ""; // per-flow CSV for sweep.py
+  bool spatialChannel = false; // cull far receivers on a GridSpectrumChannel
+  double convergence = 6;  // s of stable routes before the traffic, 0 for a fixed start
 
   CommandLine cmd;
 
@@ -156,8 +160,14 @@ int main (int argc, char *argv[])
   cmd.AddValue ("verbose", "turn on all WifiNetDevice log components", verbose);
   cmd.AddValue ("tracing", "turn on ascii and pcap tracing", tracing);
   cmd.AddValue ("numNodes", "number of nodes", numNodes);
+  cmd.AddValue ("rtsCtsThreshold", "RTS/CTS threshold (bytes)", rtsCtsThreshold);
+  cmd.AddValue ("summary", "write a per-flow CSV summary to this file", summary);
+  cmd.AddValue ("spatialChannel", "use SpectrumWifiPhy on a GridSpectrumChannel that skips receivers below the ED threshold", spatialChannel);
+  cmd.AddValue ("convergence", "start the traffic after the routes are stable for this many seconds, 31 s at the latest (0: at 31 s)", convergence);
 
   cmd.Parse (argc, argv);
+  // per-run file names under sweep.py, which runs many of us at once
+  std::string output = FlowSummary::OutputPrefix (summary, "./scratch/");
   // Convert to time object
   Time interPacketInterval = Seconds (interval);
   GlobalValue::Bind("ChecksumEnabled", BooleanValue(true));
@@ -167,8 +177,8 @@ int main (int argc, char *argv[])
 
   // disable fragmentation for frames below 2200 bytes
   Config::SetDefault ("ns3::WifiRemoteStationManager::FragmentationThreshold", StringValue ("2200"));
-  // turn off RTS/CTS for frames below 2200 bytes
-  Config::SetDefault ("ns3::WifiRemoteStationManager::RtsCtsThreshold", StringValue ("2200"));
+  // turn off RTS/CTS for frames below rtsCtsThreshold bytes
+  Config::SetDefault ("ns3::WifiRemoteStationManager::RtsCtsThreshold", UintegerValue (rtsCtsThreshold));
   // Fix non-unicast data rate to be the same as that of unicast
   Config::SetDefault ("ns3::WifiRemoteStationManager::NonUnicastMode", StringValue (phyMode));
 
@@ -196,6 +206,28 @@ int main (int argc, char *argv[])
   wifiChannel.AddPropagationLoss ("ns3::FriisPropagationLossModel");
   wifiPhy.SetChannel (wifiChannel.Create ());
 
+  // Same PHY on a spectrum channel that only schedules receptions for
+  // nodes within reach: path loss more than 10 dB above what the ED
+  // threshold allows (TxPower + TxGain + RxGain - EnergyDetectionThreshold,
+  // the gains being WifiPhy's 1 dB defaults) is culled, and far cells of
+  // the grid are never visited.  Culled signals add no interference, see
+  // grid-spectrum-channel.h.
+  SpectrumWifiPhyHelper spectrumPhy = SpectrumWifiPhyHelper::Default ();
+  if (spatialChannel)
+    {
+      spectrumPhy.Set("TxPowerStart", DoubleValue(5));
+      spectrumPhy.Set("TxPowerEnd", DoubleValue(5));
+      spectrumPhy.Set("EnergyDetectionThreshold", DoubleValue(-83.0) );
+      Ptr<GridSpectrumChannel> gridChannel = CreateObject<GridSpectrumChannel> ();
+      gridChannel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+      gridChannel->AddPropagationLossModel (CreateObject<FriisPropagationLossModel> ());
+      gridChannel->SetAttribute ("MaxLossDb", DoubleValue (GridSpectrumChannel::GetMaxLossDb (5, 1, 1, -83.0, 10)));
+      spectrumPhy.SetChannel (gridChannel);
+    }
+
+  WifiPhyHelper &phy = spatialChannel ? static_cast<WifiPhyHelper &> (spectrumPhy)
+                                      : static_cast<WifiPhyHelper &> (wifiPhy);
+
   // Add a non-QoS upper mac, and disable rate control
   NqosWifiMacHelper wifiMac = NqosWifiMacHelper::Default ();
   wifi.SetStandard (WIFI_PHY_STANDARD_80211g);
@@ -204,7 +236,7 @@ int main (int argc, char *argv[])
                                 "ControlMode",StringValue (phyMode));
   // Set it to adhoc mode
   wifiMac.SetType ("ns3::AdhocWifiMac");
-  NetDeviceContainer devices = wifi.Install (wifiPhy, wifiMac, c);
+  NetDeviceContainer devices = wifi.Install (phy, wifiMac, c);
 
   MobilityHelper mobility;
   
@@ -238,7 +270,15 @@ int main (int argc, char *argv[])
 
   Ipv4AddressHelper ipv4;
   NS_LOG_INFO ("Assign IP Addresses.");
-  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
+  // a /24 holds 254 hosts; larger networks get a /16 with the same first addresses
+  if (numNodes > 254)
+    {
+      ipv4.SetBase ("10.1.0.0", "255.255.0.0", "0.0.1.1");
+    }
+  else
+    {
+      ipv4.SetBase ("10.1.1.0", "255.255.255.0");
+    }
   Ipv4InterfaceContainer i = ipv4.Assign (devices);
 
   TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
@@ -251,32 +291,48 @@ int main (int argc, char *argv[])
   InetSocketAddress remote = InetSocketAddress (i.GetAddress (sinkNode, 0), 80);
   source->Connect (remote);
 
+  RouteJournal journal;
   if (tracing == true)
     {
       AsciiTraceHelper ascii;
-      wifiPhy.EnableAsciiAll (ascii.CreateFileStream ("./scratch/myManet.tr"));
+      phy.EnableAsciiAll (ascii.CreateFileStream (output + "myManet.tr"));
       //wifiPhy.EnablePcap ("./scratch/myManet", devices);
-      wifiPhy.EnablePcap ("./scratch/myManet", devices.Get (sourceNode));
-      wifiPhy.EnablePcap ("./scratch/myManet", devices.Get (sinkNode));
-      // Trace routing tables
-      Ptr<OutputStreamWrapper> routingStream = Create<OutputStreamWrapper> ("./scratch/myManet.routes", std::ios::out);
-      olsr.PrintRoutingTableAllEvery (Seconds (2), routingStream);
-      Ptr<OutputStreamWrapper> neighborStream = Create<OutputStreamWrapper> ("./scratch/myManet.neighbors", std::ios::out);
-      olsr.PrintNeighborCacheAllEvery (Seconds (2), neighborStream);
+      phy.EnablePcap (output + "myManet", devices.Get (sourceNode));
+      phy.EnablePcap (output + "myManet", devices.Get (sinkNode));
+      // Journal routing table and neighbor cache changes; "routes.py table
+      // ./scratch/myManet.journal <node> <time>" rebuilds a node's table
+      journal.Open (output + "myManet.journal");
+      journal.EnableOlsr (c);
+      journal.EnableNeighbors (c, Seconds (2));
 
       // To do-- enable an IP-level trace that shows forwarding events only
     }
 
   // Give OLSR time to converge-- 30 seconds perhaps
-  Simulator::Schedule (Seconds (31.0), &GenerateTraffic, 
-                       source, packetSize, numPackets, interPacketInterval);
+  Ptr<BatchTrafficGenerator> traffic = CreateObject<BatchTrafficGenerator> ();
+  traffic->SetSeqTs (true);
+  traffic->AddSource (source, packetSize, numPackets, interPacketInterval);
+  c.Get (sourceNode)->AddApplication (traffic);
+  traffic->SetStartTime (Seconds (31.0));
+  // Start as soon as every node has a route to every other one, and the
+  // tables have not moved for 'convergence' seconds
+  // (no --loadWarm here: the nodes move, and preloaded routes would
+  // outlive the links they were learnt on, see warm-state.h)
+  ConvergenceMonitor convergenceMonitor;
+  if (convergence > 0)
+    {
+      convergenceMonitor.SetWindow (Seconds (convergence));
+      convergenceMonitor.SetMinRoutes (numNodes - 1);
+      convergenceMonitor.SetTimeout (Seconds (31.0));
+      convergenceMonitor.Install (c, MakeBoundCallback (&StartTraffic, traffic, Seconds (50.0 - 31.0)));
+    }
 
   // Output what we are doing
   NS_LOG_UNCOND ("Source node is: " << sourceNode << " to sink node: " << sinkNode);
   
   
   // Gnuplot parameters      
-  std::string fileNameWithNoExtension = "./scratch/FlowVSThroughput_";
+  std::string fileNameWithNoExtension = output + "FlowVSThroughput_";
   std::string graphicsFileName        = fileNameWithNoExtension + ".png";
   std::string plotFileName            = fileNameWithNoExtension + ".plt";
   std::string plotTitle               = "Flow vs Throughput";
@@ -291,26 +347,31 @@ int main (int argc, char *argv[])
   gnuplot.SetTerminal ("png");
 
   // Set the labels for each axis.
-  gnuplot.SetLegend ("Flow", "Throughput");
+  gnuplot.SetLegend ("Time (s)", "Throughput (Mbps)");
      
-  Gnuplot2dDataset dataset;
-  dataset.SetTitle (dataTitle);
-  dataset.SetStyle (Gnuplot2dDataset::LINES_POINTS);
+  ThroughputSeries series;
+  series.Open (fileNameWithNoExtension + ".tps");
   
   // Flow monitor
   Ptr<FlowMonitor> flowMonitor;
   FlowMonitorHelper flowHelper;
   flowMonitor = flowHelper.InstallAll();
+  FlowSnapshotWriter snapshot;
+  snapshot.Open (output + "ThroughputMonitor.snap");
+  FlowCounterTable counters;
+  FlowRateEstimator rates (40); // IPv4 + UDP + SeqTsHeader
   
   // call the flow monitor function
-  ThroughputMonitor(&flowHelper, flowMonitor, dataset);
+  ThroughputMonitor(&flowHelper, flowMonitor, &series, &snapshot, &rates, &counters);
 
   //Simulator::Stop (Seconds(4000.0));
   Simulator::Stop (Seconds(50.0)); // for testing/debugging only
   Simulator::Run ();
+  journal.Close ();
   
   //Gnuplot ...continued
-  gnuplot.AddDataset (dataset);
+  series.ExportGnuplot (gnuplot, dataTitle);
+  series.ExportCsv (fileNameWithNoExtension + ".csv");
   // Open the plot file.
   std::ofstream plotFile (plotFileName.c_str());
   // Write the plot file.
@@ -332,7 +393,11 @@ int main (int argc, char *argv[])
 	  NS_LOG_UNCOND("Throughput: " << iter->second.rxBytes * 8.0 / (iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds()) / 1024  << " Kbps");
   }       
   */
-  flowMonitor->SerializeToXmlFile("./scratch/myManet.xml", true, true);
+  flowMonitor->SerializeToXmlFile(output + "myManet.xml", true, true);
+  if (!summary.empty ())
+    {
+      FlowSummary::Write (flowMonitor, flowHelper, summary);
+    }
   
   Simulator::Destroy ();
 
@@ -52,6 +52,7 @@
 #include "ns3/mesh-module.h"
 #include "ns3/mobility-module.h"
 #include "ns3/mesh-helper.h"
+#include "pcap-capture.h"
 
 #include <iostream>
 #include <sstream>
@@ -91,6 +92,8 @@ private:
   Ipv4InterfaceContainer interfaces;
   // MeshHelper. Report is not static methods
   MeshHelper mesh;
+  /// Capture of the mesh interfaces into one pcapng, if m_pcap
+  PcapCapture m_capture;
 private:
   /// Create nodes and setup their mobility
   void CreateNodes ();
@@ -196,7 +199,10 @@ MeshTest::CreateNodes ()
   mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
   mobility.Install (nodes);
   if (m_pcap)
-    wifiPhy.EnablePcapAll (std::string ("mp-"));
+    {
+      m_capture.Open ("mp.pcapng");
+      m_capture.AddAll ();
+    }
 }
 void
 MeshTest::InstallInternetStack ()
@@ -231,6 +237,7 @@ MeshTest::Run ()
   Simulator::Schedule (Seconds (m_totalTime), &MeshTest::Report, this);
   Simulator::Stop (Seconds (m_totalTime));
   Simulator::Run ();
+  m_capture.Close ();
   Simulator::Destroy ();
   return 0;
 }
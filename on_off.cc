@@ -5,29 +5,34 @@
 #include"ns3/netanim-module.h"
 #include"ns3/internet-module.h"
 #include "ns3/mobility-module.h"
-#include <sys/time.h>
-#include <ctime>
+
+#include "seed-plan.h"
+
+#include <sstream>
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("OnOffAppExp");
 
-long getCurrentTime(){
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec*1000 + tv.tv_usec/1000;
-}
-
 int
 main(int argc, char *argv[])
 {
-    RngSeedManager::SetSeed(getCurrentTime());
-    RngSeedManager::SetRun(std::time(0));
+    // --RngSeed/--RngRun pick the numbers; --fresh draws a new run and logs it
+    bool fresh = false;
+    CommandLine cmd;
+    cmd.AddValue("fresh", "Use a random RngRun instead of the configured one", fresh);
+    cmd.Parse(argc, argv);
+    if(fresh){
+        SeedPlan::Apply(RngSeedManager::GetSeed(), SeedPlan::Fresh());
+    }
 
     Time::SetResolution (Time::NS);
     LogComponentEnable("OnOffAppExp", LOG_LEVEL_INFO);
     LogComponentEnable("PacketSink", LOG_LEVEL_INFO);
     //LogComponentEnable("DataRate", LOG_LEVEL_INFO);
+    std::ostringstream seed;
+    SeedPlan::Record(seed);
+    NS_LOG_INFO(seed.str());
 
     uint32_t nNodes = 2;
     NodeContainer p2pNodes;
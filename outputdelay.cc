@@ -6,14 +6,17 @@
 #include "ns3/mobility-module.h"
 #include "ns3/csma-module.h"
 #include "ns3/internet-module.h"
-#include "src/network/helper/delay-jitter-estimation.cc"
 #include "ns3/traffic-control-module.h"
 #include "ns3/flow-monitor-module.h"
 
+#include "flow-counters.h"
+#include "flow-delay-estimator.h"
+#include "seq-ts-sink.h"
+
 using namespace ns3;
 NS_LOG_COMPONENT_DEFINE ("ex4");
 
-DelayJitterEstimation delayJitter;
+FlowDelayEstimator delays;
 
 
 class MyApp : public Application 
@@ -98,9 +101,11 @@ MyApp::StopApplication (void)
 void 
 MyApp::SendPacket (void)
 {
-  Ptr<Packet> packet = Create<Packet> (m_packetSize);
-  DelayJitterEstimationTimestampTag tag; 
-  packet->AddByteTag (tag);
+  SeqTsHeader seqTs;
+  seqTs.SetSeq (m_packetsSent);
+  Ptr<Packet> packet = Create<Packet> (m_packetSize - seqTs.GetSerializedSize ());
+  packet->AddHeader (seqTs);
+  FlowDelayEstimator::Stamp (packet);
   m_socket->Send (packet);
 
   if (++m_packetsSent < m_nPackets)
@@ -130,31 +135,27 @@ RxCnt (Ptr<const Packet> p, const Address &a)
 
 
 static void
-CalculateDelay (Ptr<const Packet> p, const Address &a)
+CalculateDelay (Ptr<const Packet> p, const Address &a, const SeqTsFlowStats &stats)
 //CalculateDelay (Ptr<const Packet> p)
 {
-
-    static float k = 0;
-    k++;
-    static float m = -1;
-    static float n = 0;
-    n += (p->GetUid()-m)/2-1;
-
-
-    delayJitter.RecordRx(p); 
-    Time delay = delayJitter.GetLastDelay();
-    m = p->GetUid();
+    // loss comes from the sink's per-source sequence window, not packet uids
+    Time delay = delays.Record (p, a);
    
-    NS_LOG_UNCOND ("Delay: " << Simulator::Now ().GetSeconds () << "\t" << delay.GetMilliSeconds()<<" "<<m<<" "<<n) ;
+    NS_LOG_INFO ("Delay: " << Simulator::Now ().GetSeconds () << "\t" << delay.GetMilliSeconds()<<" "<<stats.received<<" "<<stats.GetLost ()) ;
     //NS_LOG_UNCOND ("Delay: " << Simulator::Now ().GetSeconds () << "\t" << delay.GetMilliSeconds()) ; 
 }
 
-static void outputDelay(Ptr<FlowMonitor> monitor, Time interval)
+static void outputDelay(Ptr<FlowMonitor> monitor, FlowCounterTable *counters, Time interval)
 {
-    std::map<FlowId, FlowMonitor::FlowStats> flowstats = monitor->GetFlowStats();
-    std::cout << "  Mean delay:   " << flowstats[1].delaySum.GetSeconds () / flowstats[1].rxPackets;
-    std::cout << "  Mean jitter:   " << flowstats[1].jitterSum.GetSeconds () / (flowstats[1].rxPackets - 1) << std::endl; 
-    Simulator::Schedule (interval, &outputDelay, monitor, interval);   
+    // read flow 1 from the table; no empty flow is inserted
+    counters->Update (monitor);
+    const FlowMonitor::FlowStats *flow = counters->Find (1);
+    if (flow != 0 && flow->rxPackets > 1)
+    {
+        std::cout << "  Mean delay:   " << flow->delaySum.GetSeconds () / flow->rxPackets;
+        std::cout << "  Mean jitter:   " << flow->jitterSum.GetSeconds () / (flow->rxPackets - 1) << std::endl; 
+    }
+    Simulator::Schedule (interval, &outputDelay, monitor, counters, interval);   
 }
 
 int 
@@ -162,7 +163,7 @@ main (int argc, char *argv[])
 {
 
 	int nWifi = 5;
-	int16_t pktSize=1000;
+	uint32_t pktSize=1000;
 	uint16_t thre=2000;
 
 	CommandLine cmd;
@@ -170,6 +171,9 @@ main (int argc, char *argv[])
 	cmd.AddValue ("pktSize", "Size of UDP packet", pktSize);
 	cmd.AddValue ("thre", "RTC/CTS threshold", thre);
 	cmd.Parse (argc,argv);
+	// the payload is what is left of pktSize after the SeqTsHeader
+	NS_ABORT_MSG_UNLESS (pktSize >= SeqTsHeader ().GetSerializedSize () && pktSize <= 65507,
+	                     "pktSize must be " << SeqTsHeader ().GetSerializedSize () << " to 65507 bytes");
 
 
 	NodeContainer wifiStaNodes;
@@ -230,8 +234,10 @@ main (int argc, char *argv[])
 
 	uint16_t port = 20803;
 
-	PacketSinkHelper udpsink ("ns3::UdpSocketFactory", Address (InetSocketAddress (Ipv4Address::GetAny (), port)));
-	ApplicationContainer udpapp = udpsink.Install (wifiApNode.Get (0));
+	Ptr<SeqTsSink> udpsink = CreateObject<SeqTsSink> ();
+	udpsink->SetAttribute ("Local", AddressValue (InetSocketAddress (Ipv4Address::GetAny (), port)));
+	wifiApNode.Get (0)->AddApplication (udpsink);
+	ApplicationContainer udpapp (udpsink);
 	udpapp.Start (Seconds (0.0));
 	udpapp.Stop (Seconds (7.0));
 
@@ -250,8 +256,7 @@ main (int argc, char *argv[])
 	Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
 
 	udpapp.Get(0)->TraceConnectWithoutContext ("Rx", MakeCallback(&RxCnt));
-        udpapp.Get(0)->TraceConnectWithoutContext ("PhyRxEnd", MakeCallback 
-(&CalculateDelay));
+        udpapp.Get(0)->TraceConnectWithoutContext ("RxStats", MakeCallback (&CalculateDelay));
 	Simulator::Stop (Seconds (7.0));
 
 	phy.SetPcapDataLinkType(YansWifiPhyHelper::DLT_IEEE802_11_RADIO);
@@ -259,9 +264,10 @@ main (int argc, char *argv[])
 
     FlowMonitorHelper flowmon;
     Ptr<FlowMonitor> monitor = flowmon.InstallAll();
+    FlowCounterTable counters;
     
     Time interval = Seconds(0.2);
-    Simulator::Schedule (Seconds (1.1), &outputDelay, monitor, interval);
+    Simulator::Schedule (Seconds (1.1), &outputDelay, monitor, &counters, interval);
 
 	Simulator::Run ();
 
@@ -271,7 +277,8 @@ main (int argc, char *argv[])
 	Simulator::Destroy ();
 
     NS_LOG_UNCOND("Number of STAs= " << nWifi << ", PacketSize= "<< pktSize << ", RtsCtsThreshold= "<< thre << "   =>  Throughput= "<< (double)data*8/1000/1000/5 <<"Mbps");
-   NS_LOG_UNCOND ("m_delay:" << delayJitter.GetLastDelay().GetSeconds() << " m_jitter:" << delayJitter.GetLastJitter());
+   delays.Print (std::cout);
+   udpsink->Print (std::cout);
 
 
 }
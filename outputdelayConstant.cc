@@ -6,14 +6,15 @@
 #include "ns3/mobility-module.h"
 #include "ns3/csma-module.h"
 #include "ns3/internet-module.h"
-#include "src/network/helper/delay-jitter-estimation.cc"
 #include "ns3/traffic-control-module.h"
 #include "ns3/flow-monitor-module.h"
 
+#include "flow-delay-estimator.h"
+
 using namespace ns3;
 NS_LOG_COMPONENT_DEFINE ("ex4");
 
-DelayJitterEstimation delayJitter;
+FlowDelayEstimator delays;
 
 
 class MyApp : public Application 
@@ -99,8 +100,7 @@ void
 MyApp::SendPacket (void)
 {
   Ptr<Packet> packet = Create<Packet> (m_packetSize);
-  DelayJitterEstimationTimestampTag tag; 
-  packet->AddByteTag (tag);
+  FlowDelayEstimator::Stamp (packet);
   m_socket->Send (packet);
 
   if (++m_packetsSent < m_nPackets)
@@ -141,11 +141,10 @@ CalculateDelay (Ptr<const Packet> p, const Address &a)
     n += (p->GetUid()-m)/2-1;
 
 
-    delayJitter.RecordRx(p); 
-    Time delay = delayJitter.GetLastDelay();
+    Time delay = delays.Record (p, a);
     m = p->GetUid();
    
-    NS_LOG_UNCOND ("Delay: " << Simulator::Now ().GetSeconds () << "\t" << delay.GetMilliSeconds()<<" "<<m<<" "<<n) ;
+    NS_LOG_INFO ("Delay: " << Simulator::Now ().GetSeconds () << "\t" << delay.GetMilliSeconds()<<" "<<m<<" "<<n) ;
     //NS_LOG_UNCOND ("Delay: " << Simulator::Now ().GetSeconds () << "\t" << delay.GetMilliSeconds()) ; 
 }
 
@@ -242,8 +241,7 @@ main (int argc, char *argv[])
 	Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
 
 	udpapp.Get(0)->TraceConnectWithoutContext ("Rx", MakeCallback(&RxCnt));
-        udpapp.Get(0)->TraceConnectWithoutContext ("PhyRxEnd", MakeCallback 
-(&CalculateDelay));
+        udpapp.Get(0)->TraceConnectWithoutContext ("Rx", MakeCallback (&CalculateDelay));
 	Simulator::Stop (Seconds (7.0));
 
 	phy.SetPcapDataLinkType(YansWifiPhyHelper::DLT_IEEE802_11_RADIO);
@@ -260,7 +258,7 @@ main (int argc, char *argv[])
 	Simulator::Destroy ();
 
     NS_LOG_UNCOND("Number of STAs= " << nWifi << ", PacketSize= "<< pktSize << ", RtsCtsThreshold= "<< thre << "   =>  Throughput= "<< (double)data*8/1000/1000/5 <<"Mbps");
-   NS_LOG_UNCOND ("m_delay:" << delayJitter.GetLastDelay().GetSeconds() << " m_jitter:" << delayJitter.GetLastJitter());
+   delays.Print (std::cout);
 
 
 }
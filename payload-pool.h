@@ -0,0 +1,102 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Shared payloads for generated packets.
+ *
+ * PayloadPool builds one template packet per payload size, filled with a
+ * repeating pattern, and hands out Packet::Copy () of it, so the pattern
+ * is laid out once per size instead of once per packet.
+ *
+ * This does not make a packet's cost independent of its size.  A copy
+ * shares the template's buffer only until a header is added: Buffer lets
+ * one packet write in front of a shared buffer, and every later copy
+ * that calls AddAtStart gets a new buffer with the bytes memcpy'd in, as
+ * Create<Packet> (buffer, size) does.  Zero-filled payloads are a Buffer
+ * zero area, which is never allocated nor copied, so Create<Packet>
+ * (size) was already O(1), and an empty pattern gains nothing from the
+ * pool.
+ */
+
+#ifndef PAYLOAD_POOL_H
+#define PAYLOAD_POOL_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include <string>
+#include <vector>
+#include <map>
+
+namespace ns3 {
+
+class PayloadPool
+{
+public:
+  // An empty pattern gives zero-filled payloads, like Create<Packet> (size).
+  PayloadPool (std::string pattern = "")
+    : m_pattern (pattern)
+  {
+  }
+
+  void SetPattern (std::string pattern)
+  {
+    m_pattern = pattern;
+    m_templates.clear ();
+  }
+
+  // The shared template of 'size' bytes; built on first use.
+  Ptr<const Packet> Get (uint32_t size)
+  {
+    std::map<uint32_t, Ptr<const Packet> >::const_iterator it = m_templates.find (size);
+    if (it != m_templates.end ())
+      {
+        return it->second;
+      }
+    // ns3:: because the Create member below hides the template
+    Ptr<Packet> p;
+    if (m_pattern.empty ())
+      {
+        p = ns3::Create<Packet> (size);
+      }
+    else
+      {
+        std::vector<uint8_t> bytes (size);
+        for (uint32_t i = 0; i < size; ++i)
+          {
+            bytes[i] = m_pattern[i % m_pattern.size ()];
+          }
+        p = ns3::Create<Packet> (size > 0 ? &bytes[0] : 0, size);
+      }
+    m_templates[size] = p;
+    return p;
+  }
+
+  // A new packet sharing the payload bytes of the template.
+  Ptr<Packet> Create (uint32_t size)
+  {
+    return Get (size)->Copy ();
+  }
+
+private:
+  std::string m_pattern;
+  std::map<uint32_t, Ptr<const Packet> > m_templates;
+};
+
+} // namespace ns3
+
+#endif /* PAYLOAD_POOL_H */
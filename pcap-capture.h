@@ -0,0 +1,412 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Selective packet capture of many devices into one pcapng file.
+ *
+ * EnablePcapAll opens one file per device and writes every frame in
+ * full.  PcapCapture writes a single pcapng file with one interface per
+ * captured device, named "<node>/<ifIndex>".  Each device has a
+ * CapturePolicy:
+ *
+ *   sampleEvery  keep 1 packet in N (per device, counted after the filter)
+ *   start, stop  keep packets inside [start, stop) only
+ *   snapLen      bytes kept of each packet
+ *   filter       IPv4 protocol and/or port (either direction), e.g.
+ *                CaptureFilter::Udp (80) or CaptureFilter::Olsr ()
+ *
+ * A packet rejected by the time window or the filter costs no copy
+ * beyond the headers needed to decide.
+ *
+ * The frames are those the pcap helpers write: the PHY PhyTxBegin /
+ * PhyRxEnd packet of a WifiNetDevice (802.11, as DLT_IEEE802_11), and the
+ * PromiscSniffer packet of a CSMA (Ethernet) or point-to-point (PPP)
+ * device.  wireshark and tcpdump >= 4.1 read the result; "editcap -F
+ * pcap" splits it back if needed.
+ *
+ * Usage:
+ *   CapturePolicy policy;
+ *   policy.snapLen = 128;
+ *   policy.filter = CaptureFilter::Udp (9);
+ *   PcapCapture capture;
+ *   capture.Open ("pcap/apcsmaext.pcapng");
+ *   capture.SetDefaultPolicy (policy);
+ *   capture.AddAll ();
+ */
+
+#ifndef PCAP_CAPTURE_H
+#define PCAP_CAPTURE_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include "trace-binder.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <sstream>
+#include <vector>
+
+namespace ns3 {
+
+struct CaptureFilter
+{
+  CaptureFilter ()
+    : protocol (0),
+      port (0)
+  {
+  }
+
+  CaptureFilter (uint8_t proto, uint16_t p)
+    : protocol (proto),
+      port (p)
+  {
+  }
+
+  static CaptureFilter Udp (uint16_t port = 0)
+  {
+    return CaptureFilter (17, port);
+  }
+
+  static CaptureFilter Tcp (uint16_t port = 0)
+  {
+    return CaptureFilter (6, port);
+  }
+
+  static CaptureFilter Olsr (void)
+  {
+    return CaptureFilter (17, 698);
+  }
+
+  bool Any (void) const
+  {
+    return protocol == 0 && port == 0;
+  }
+
+  uint8_t protocol;   // IPv4 protocol number, 0 for any
+  uint16_t port;      // TCP/UDP source or destination port, 0 for any
+};
+
+struct CapturePolicy
+{
+  CapturePolicy ()
+    : sampleEvery (1),
+      start (Seconds (0)),
+      stop (Time::Max ()),
+      snapLen (65535)
+  {
+  }
+
+  uint32_t sampleEvery;
+  Time start;
+  Time stop;
+  uint32_t snapLen;
+  CaptureFilter filter;
+};
+
+class PcapCapture
+{
+public:
+  // pcap link types
+  enum LinkType
+  {
+    LINK_ETHERNET = 1,
+    LINK_PPP = 9,
+    LINK_IEEE802_11 = 105
+  };
+
+  PcapCapture ()
+  {
+  }
+
+  void Open (std::string fileName)
+  {
+    m_file.open (fileName.c_str (), std::ios::out | std::ios::binary);
+    NS_ABORT_MSG_UNLESS (m_file.is_open (), "Can't open " << fileName);
+    // section header block: byte-order magic, version 1.0, unknown length
+    std::string body;
+    Put32 (body, 0x1a2b3c4d);
+    Put16 (body, 1);
+    Put16 (body, 0);
+    Put32 (body, 0xffffffff);
+    Put32 (body, 0xffffffff);
+    WriteBlock (0x0a0d0d0a, body);
+  }
+
+  void SetDefaultPolicy (const CapturePolicy &policy)
+  {
+    m_default = policy;
+  }
+
+  // Capture every device of every node with the default policy.
+  void AddAll (void)
+  {
+    for (NodeList::Iterator n = NodeList::Begin (); n != NodeList::End (); ++n)
+      {
+        for (uint32_t i = 0; i < (*n)->GetNDevices (); ++i)
+          {
+            Add ((*n)->GetDevice (i), m_default);
+          }
+      }
+  }
+
+  void Add (NetDeviceContainer devices)
+  {
+    Add (devices, m_default);
+  }
+
+  void Add (NetDeviceContainer devices, const CapturePolicy &policy)
+  {
+    for (NetDeviceContainer::Iterator i = devices.Begin (); i != devices.End (); ++i)
+      {
+        Add (*i, policy);
+      }
+  }
+
+  /*
+   * Capture one device.  Devices other than wifi, CSMA and point-to-point
+   * (bridges, mesh points, loopback) are skipped; a mesh point's wifi
+   * interfaces are devices of their own.  Returns false if skipped.
+   */
+  bool Add (Ptr<NetDevice> device, const CapturePolicy &policy)
+  {
+    NS_ABORT_MSG_UNLESS (m_file.is_open (), "PcapCapture::Open first");
+    NS_ABORT_MSG_UNLESS (policy.sampleEvery > 0, "CapturePolicy::sampleEvery must be 1 or more");
+    Ptr<Object> source;
+    uint16_t link;
+    Ptr<WifiNetDevice> wifi = DynamicCast<WifiNetDevice> (device);
+    if (wifi != 0)
+      {
+        source = wifi->GetPhy ();
+        link = LINK_IEEE802_11;
+      }
+    else if (DynamicCast<CsmaNetDevice> (device) != 0)
+      {
+        source = device;
+        link = LINK_ETHERNET;
+      }
+    else if (DynamicCast<PointToPointNetDevice> (device) != 0)
+      {
+        source = device;
+        link = LINK_PPP;
+      }
+    else
+      {
+        return false;
+      }
+
+    Interface *itf = m_interfaces.Add (Interface (this, m_interfaces.GetN (), link, policy));
+    std::ostringstream name;
+    name << device->GetNode ()->GetId () << "/" << device->GetIfIndex ();
+    WriteInterface (link, policy.snapLen, name.str ());
+    if (link == LINK_IEEE802_11)
+      {
+        m_interfaces.Connect (source, "PhyTxBegin", &PcapCapture::Sniff, itf);
+        m_interfaces.Connect (source, "PhyRxEnd", &PcapCapture::Sniff, itf);
+      }
+    else
+      {
+        m_interfaces.Connect (source, "PromiscSniffer", &PcapCapture::Sniff, itf);
+      }
+    return true;
+  }
+
+  void Close (void)
+  {
+    m_file.close ();
+  }
+
+private:
+  struct Interface
+  {
+    Interface (PcapCapture *c, uint32_t i, uint16_t l, const CapturePolicy &p)
+      : capture (c),
+        id (i),
+        link (l),
+        policy (p),
+        seen (0)
+    {
+    }
+
+    PcapCapture *capture;
+    uint32_t id;
+    uint16_t link;
+    CapturePolicy policy;
+    uint64_t seen;        // packets that passed the window and the filter
+  };
+
+  static void Sniff (Interface *itf, Ptr<const Packet> p)
+  {
+    itf->capture->Capture (*itf, p);
+  }
+
+  void Capture (Interface &itf, Ptr<const Packet> p)
+  {
+    const CapturePolicy &policy = itf.policy;
+    Time now = Simulator::Now ();
+    if (now < policy.start || now >= policy.stop || !m_file.is_open ())
+      {
+        return;
+      }
+    if (!policy.filter.Any () && !Match (itf.link, policy.filter, p))
+      {
+        return;
+      }
+    if (itf.seen++ % policy.sampleEvery != 0)
+      {
+        return;
+      }
+
+    uint32_t size = p->GetSize ();
+    uint32_t captured = std::min (size, policy.snapLen);
+    uint64_t ts = now.GetNanoSeconds ();
+    std::string body;
+    Put32 (body, itf.id);
+    Put32 (body, ts >> 32);
+    Put32 (body, ts & 0xffffffff);
+    Put32 (body, captured);
+    Put32 (body, size);
+    body.resize (body.size () + captured);
+    if (captured > 0)
+      {
+        p->CopyData (reinterpret_cast<uint8_t *> (&body[body.size () - captured]), captured);
+      }
+    body.resize ((body.size () + 3) & ~3);
+    WriteBlock (6, body);
+  }
+
+  /*
+   * Whether the IPv4 packet carried by the frame matches 'filter'.  Only
+   * the first 128 bytes are copied to find out.
+   */
+  static bool Match (uint16_t link, const CaptureFilter &filter, Ptr<const Packet> p)
+  {
+    uint8_t b[128];
+    uint32_t n = p->CopyData (b, sizeof (b));
+    uint32_t ip;
+    switch (link)
+      {
+      case LINK_ETHERNET:
+        if (n < 14 || b[12] != 0x08 || b[13] != 0x00)
+          {
+            return false;
+          }
+        ip = 14;
+        break;
+      case LINK_PPP:
+        if (n < 2 || b[0] != 0x00 || b[1] != 0x21)
+          {
+            return false;
+          }
+        ip = 2;
+        break;
+      default:
+        {
+          // 802.11 data frame, 24 bytes header, 26 with QoS, +6 with 4 addresses,
+          // then LLC/SNAP with the ethertype
+          if (n < 24 || ((b[0] >> 2) & 3) != 2)
+            {
+              return false;
+            }
+          ip = 24 + ((b[0] & 0x80) ? 2 : 0) + ((b[1] & 3) == 3 ? 6 : 0);
+          if (n < ip + 8 || b[ip] != 0xaa || b[ip + 6] != 0x08 || b[ip + 7] != 0x00)
+            {
+              return false;
+            }
+          ip += 8;
+        }
+      }
+    if (n < ip + 20 || (b[ip] >> 4) != 4)
+      {
+        return false;
+      }
+    uint8_t protocol = b[ip + 9];
+    if (filter.protocol != 0 && protocol != filter.protocol)
+      {
+        return false;
+      }
+    if (filter.port == 0)
+      {
+        return true;
+      }
+    if (protocol != 6 && protocol != 17)
+      {
+        return false;
+      }
+    uint32_t l4 = ip + (b[ip] & 0x0f) * 4;
+    if (n < l4 + 4)
+      {
+        return false;
+      }
+    uint16_t src = (b[l4] << 8) | b[l4 + 1];
+    uint16_t dst = (b[l4 + 2] << 8) | b[l4 + 3];
+    return src == filter.port || dst == filter.port;
+  }
+
+  // interface description block with if_name and nanosecond if_tsresol
+  void WriteInterface (uint16_t link, uint32_t snapLen, std::string name)
+  {
+    std::string body;
+    Put16 (body, link);
+    Put16 (body, 0);
+    Put32 (body, snapLen);
+    Put16 (body, 2);
+    Put16 (body, name.size ());
+    body += name;
+    body.resize ((body.size () + 3) & ~3);
+    Put16 (body, 9);
+    Put16 (body, 1);
+    body += std::string ("\x09\0\0\0", 4);
+    Put32 (body, 0);    // opt_endofopt
+    WriteBlock (1, body);
+  }
+
+  void WriteBlock (uint32_t type, const std::string &body)
+  {
+    std::string block;
+    uint32_t length = 12 + body.size ();
+    Put32 (block, type);
+    Put32 (block, length);
+    block += body;
+    Put32 (block, length);
+    m_file.write (block.data (), block.size ());
+  }
+
+  static void Put16 (std::string &s, uint16_t v)
+  {
+    s.push_back (v & 0xff);
+    s.push_back (v >> 8);
+  }
+
+  static void Put32 (std::string &s, uint32_t v)
+  {
+    Put16 (s, v & 0xffff);
+    Put16 (s, v >> 16);
+  }
+
+  std::ofstream m_file;
+  CapturePolicy m_default;
+  TraceSinks<Interface> m_interfaces;
+};
+
+} // namespace ns3
+
+#endif /* PCAP_CAPTURE_H */
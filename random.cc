@@ -1,20 +1,21 @@
 #include "ns3/core-module.h"
-#include <sys/time.h>
-#include <ctime>
 
-using namespace ns3;
+#include "seed-plan.h"
 
-long getCurrentTime(){
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec*1000 + tv.tv_usec/1000;
-}
+using namespace ns3;
 
 int main(int argc, char *argv[])
 {
-    RngSeedManager::SetSeed(getCurrentTime());
-        RngSeedManager::SetRun(std::time(0));
-        //RngSeedManager::SetRun(i);
+    // --RngSeed/--RngRun pick the numbers; --fresh draws a new run and prints it
+    bool fresh = false;
+    CommandLine cmd;
+    cmd.AddValue("fresh", "Use a random RngRun instead of the configured one", fresh);
+    cmd.Parse(argc, argv);
+    if(fresh){
+        SeedPlan::Apply(RngSeedManager::GetSeed(), SeedPlan::Fresh());
+    }
+    SeedPlan::Record(std::cout);
+    std::cout<<std::endl;
         Ptr<UniformRandomVariable> x = CreateObject<UniformRandomVariable> ();   
         double Min = 0.0;
         double Max = 100.0;
@@ -0,0 +1,407 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Replications forked from one built topology.
+ *
+ * sweep.py starts a process per replication, and each one builds the same
+ * nodes, devices, stacks and addresses again.  ReplicationFork lets a
+ * script build them once and then fork(): every worker is a copy-on-write
+ * image of the parent at that point, sets its RngRun, and runs on its
+ * own.  At most SetWorkers workers run at a time.  Each worker sends the
+ * FlowSummary rows of its run back over a pipe and exits; the parent
+ * gathers them, writes them in one CSV with a leading "run" column and
+ * prints the mean and 95% confidence interval of every flow.
+ *
+ * What the worker must do itself:
+ *   - reassign the random streams created before the fork (helpers'
+ *     AssignStreams): they were seeded with the parent's run, and
+ *     RandomVariableStream::SetStream reseeds them with the worker's
+ *   - open its own output files: files opened before the fork are shared
+ *     by all workers, and threads (BinaryTraceWriter) do not survive it
+ *   - close them before Report: it leaves with _exit, which runs no
+ *     destructors and flushes no std::ofstream
+ *
+ * Output buffered in std::cout is flushed before forking.  With one
+ * replication nothing is forked.  POSIX only, as ns-3.
+ *
+ * Usage:
+ *   ReplicationFork fork;
+ *   fork.SetReplications (100);
+ *   if (!fork.Start ())
+ *     {
+ *       fork.Print (std::cout);    // parent: every run has reported
+ *       return 0;
+ *     }
+ *   wifi.AssignStreams (devices, 1);
+ *   ...
+ *   Simulator::Run ();
+ *   fork.Report (flowMonitor, flowHelper);    // a worker exits here
+ */
+
+#ifndef REPLICATION_FORK_H
+#define REPLICATION_FORK_H
+
+#include "ns3/core-module.h"
+#include "ns3/flow-monitor-module.h"
+
+#include "flow-summary.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace ns3 {
+
+class ReplicationFork
+{
+public:
+  ReplicationFork ()
+    : m_replications (1),
+      m_workers (sysconf (_SC_NPROCESSORS_ONLN)),
+      m_firstRun (RngSeedManager::GetRun ()),
+      m_run (m_firstRun),
+      m_worker (false),
+      m_pipe (-1),
+      m_failed (0)
+  {
+  }
+
+  void SetReplications (uint32_t replications)
+  {
+    m_replications = replications;
+  }
+
+  // Workers running at once; 0 for one per online CPU.
+  void SetWorkers (uint32_t workers)
+  {
+    m_workers = workers > 0 ? workers : sysconf (_SC_NPROCESSORS_ONLN);
+  }
+
+  // Run of the first replication; the others follow.  Default: RngRun.
+  void SetFirstRun (uint64_t run)
+  {
+    m_firstRun = run;
+  }
+
+  /*
+   * Fork the replications.  Returns true in a worker, with RngRun set to
+   * its run, and false in the parent once every worker has exited.  With
+   * one replication, returns true without forking.
+   */
+  bool Start (void)
+  {
+    if (m_replications <= 1)
+      {
+        m_run = m_firstRun;
+        RngSeedManager::SetRun (m_run);
+        return true;
+      }
+    std::cout.flush ();
+    std::cerr.flush ();
+    std::map<int, Child> running;    // by read end of the pipe
+    uint32_t next = 0;
+    while (next < m_replications || !running.empty ())
+      {
+        while (next < m_replications && running.size () < m_workers)
+          {
+            int fds[2];
+            NS_ABORT_MSG_UNLESS (pipe (fds) == 0, "pipe failed: " << std::strerror (errno));
+            uint64_t run = m_firstRun + next++;
+            pid_t pid = fork ();
+            NS_ABORT_MSG_UNLESS (pid >= 0, "fork failed: " << std::strerror (errno));
+            if (pid == 0)
+              {
+                close (fds[0]);
+                for (std::map<int, Child>::const_iterator c = running.begin (); c != running.end (); ++c)
+                  {
+                    close (c->first);
+                  }
+                m_worker = true;
+                m_pipe = fds[1];
+                m_run = run;
+                RngSeedManager::SetRun (run);
+                return true;
+              }
+            close (fds[1]);
+            running[fds[0]] = Child (pid, run);
+          }
+        Collect (running);
+      }
+    return false;
+  }
+
+  bool IsWorker (void) const
+  {
+    return m_worker;
+  }
+
+  uint64_t GetRun (void) const
+  {
+    return m_run;
+  }
+
+  /*
+   * In a worker, send the FlowSummary rows of the run to the parent and
+   * exit.  Does nothing otherwise.
+   */
+  void Report (Ptr<FlowMonitor> monitor, FlowMonitorHelper &helper)
+  {
+    if (!m_worker)
+      {
+        return;
+      }
+    std::ostringstream oss;
+    FlowSummary::Write (monitor, helper, oss);
+    std::string rows = oss.str ();
+    for (size_t done = 0; done < rows.size (); )
+      {
+        ssize_t n = write (m_pipe, rows.data () + done, rows.size () - done);
+        if (n < 0 && errno == EINTR)
+          {
+            continue;
+          }
+        if (n <= 0)
+          {
+            _exit (1);
+          }
+        done += n;
+      }
+    close (m_pipe);
+    std::cout.flush ();
+    // the parent's objects are not ours to destroy
+    _exit (0);
+  }
+
+  // Runs that exited with an error or without reporting.
+  uint32_t GetFailed (void) const
+  {
+    return m_failed;
+  }
+
+  // The rows of every run, as FlowSummary with a leading run column.
+  void Write (std::string fileName) const
+  {
+    std::ofstream os (fileName.c_str ());
+    NS_ABORT_MSG_UNLESS (os.is_open (), "Can't open " << fileName);
+    bool header = false;
+    for (std::map<uint64_t, std::string>::const_iterator r = m_reports.begin (); r != m_reports.end (); ++r)
+      {
+        std::istringstream lines (r->second);
+        std::string line;
+        while (std::getline (lines, line))
+          {
+            if (line.compare (0, 7, "flowId,") == 0)
+              {
+                if (!header)
+                  {
+                    os << "run," << line << "\n";
+                    header = true;
+                  }
+                continue;
+              }
+            os << r->first << "," << line << "\n";
+          }
+      }
+  }
+
+  /*
+   * Per flow, the mean and 95% confidence interval (Student t, as
+   * sweep.py) over the runs of throughput, delay and loss ratio.
+   */
+  void Print (std::ostream &os) const
+  {
+    // flowId -> throughputKbps, meanDelayMs, loss ratio samples
+    std::map<uint32_t, std::vector<std::vector<double> > > samples;
+    for (std::map<uint64_t, std::string>::const_iterator r = m_reports.begin (); r != m_reports.end (); ++r)
+      {
+        std::istringstream lines (r->second);
+        std::string line;
+        while (std::getline (lines, line))
+          {
+            std::vector<std::string> cells = Split (line);
+            if (cells.size () < 15 || cells[0] == "flowId")
+              {
+                continue;
+              }
+            double tx = std::atof (cells[6].c_str ());
+            std::vector<std::vector<double> > &flow = samples[std::atoi (cells[0].c_str ())];
+            flow.resize (3);
+            flow[0].push_back (std::atof (cells[12].c_str ()));
+            flow[1].push_back (std::atof (cells[13].c_str ()));
+            flow[2].push_back (tx > 0 ? std::atof (cells[8].c_str ()) / tx : 0);
+          }
+      }
+    os << m_reports.size () << " replications, runs " << m_firstRun << ".."
+       << m_firstRun + m_replications - 1;
+    if (m_failed > 0)
+      {
+        os << ", " << m_failed << " failed";
+      }
+    os << "\n";
+    const char *names[] = { "throughput (Kbps)", "delay (ms)", "loss ratio" };
+    for (std::map<uint32_t, std::vector<std::vector<double> > >::const_iterator f = samples.begin (); f != samples.end (); ++f)
+      {
+        os << "Flow " << f->first << " (" << f->second[0].size () << " runs)\n";
+        for (uint32_t k = 0; k < 3; ++k)
+          {
+            double mean, half;
+            MeanInterval (f->second[k], mean, half);
+            os << "  " << names[k] << ": " << mean << " +/- " << half << "\n";
+          }
+      }
+  }
+
+private:
+  struct Child
+  {
+    Child ()
+      : pid (0),
+        run (0)
+    {
+    }
+
+    Child (pid_t p, uint64_t r)
+      : pid (p),
+        run (r)
+    {
+    }
+
+    pid_t pid;
+    uint64_t run;
+    std::string rows;
+  };
+
+  // Read whatever the workers wrote; reap those that are done.
+  void Collect (std::map<int, Child> &running)
+  {
+    std::vector<struct pollfd> fds;
+    for (std::map<int, Child>::const_iterator c = running.begin (); c != running.end (); ++c)
+      {
+        struct pollfd p;
+        p.fd = c->first;
+        p.events = POLLIN;
+        p.revents = 0;
+        fds.push_back (p);
+      }
+    if (poll (&fds[0], fds.size (), -1) < 0)
+      {
+        NS_ABORT_MSG_UNLESS (errno == EINTR, "poll failed: " << std::strerror (errno));
+        return;
+      }
+    for (std::vector<struct pollfd>::const_iterator p = fds.begin (); p != fds.end (); ++p)
+      {
+        if (p->revents == 0)
+          {
+            continue;
+          }
+        Child &child = running[p->fd];
+        char buffer[4096];
+        ssize_t n = read (p->fd, buffer, sizeof (buffer));
+        if (n > 0)
+          {
+            child.rows.append (buffer, n);
+            continue;
+          }
+        if (n < 0 && errno == EINTR)
+          {
+            continue;
+          }
+        close (p->fd);
+        int status = 0;
+        waitpid (child.pid, &status, 0);
+        if (WIFEXITED (status) && WEXITSTATUS (status) == 0 && !child.rows.empty ())
+          {
+            m_reports[child.run] = child.rows;
+          }
+        else
+          {
+            std::cerr << "Replication run " << child.run << " failed" << std::endl;
+            m_failed++;
+          }
+        running.erase (p->fd);
+      }
+  }
+
+  static std::vector<std::string> Split (const std::string &line)
+  {
+    std::vector<std::string> cells;
+    std::istringstream is (line);
+    std::string cell;
+    while (std::getline (is, cell, ','))
+      {
+        cells.push_back (cell);
+      }
+    return cells;
+  }
+
+  static void MeanInterval (const std::vector<double> &v, double &mean, double &half)
+  {
+    mean = 0;
+    half = 0;
+    if (v.empty ())
+      {
+        return;
+      }
+    for (uint32_t i = 0; i < v.size (); ++i)
+      {
+        mean += v[i];
+      }
+    mean /= v.size ();
+    if (v.size () < 2)
+      {
+        return;
+      }
+    double ss = 0;
+    for (uint32_t i = 0; i < v.size (); ++i)
+      {
+        ss += (v[i] - mean) * (v[i] - mean);
+      }
+    // two-sided 95% Student t quantiles, by degrees of freedom
+    static const double t95[] = { 0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+                                  2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+                                  2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045,
+                                  2.042 };
+    uint32_t df = v.size () - 1;
+    double t = df <= 30 ? t95[df] : 1.96;
+    half = t * std::sqrt (ss / df / v.size ());
+  }
+
+  uint32_t m_replications;
+  uint32_t m_workers;
+  uint64_t m_firstRun;   // RngRun is 64-bit, e.g. SeedPlan::Fresh ()
+  uint64_t m_run;
+  bool m_worker;
+  int m_pipe;
+  uint32_t m_failed;
+  std::map<uint64_t, std::string> m_reports;    // run -> FlowSummary rows
+};
+
+} // namespace ns3
+
+#endif /* REPLICATION_FORK_H */
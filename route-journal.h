@@ -0,0 +1,324 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Journal of OLSR routing table and neighbor cache changes.
+ *
+ * PrintRoutingTableAllEvery and PrintNeighborCacheAllEvery print every
+ * table of every node at every period, changed or not.  RouteJournal
+ * writes only the differences:
+ *
+ *   routes     on the OLSR RoutingTableChanged trace, the node's new
+ *              table is compared with the previous one; nothing is
+ *              polled
+ *   neighbors  the ARP caches have no change trace, so they are read
+ *              every 'interval' and compared with the previous read
+ *
+ * One line per change, times in seconds:
+ *   <time> <node> R+ <dest> <next> <iface> <distance>   route added
+ *   <time> <node> R~ <dest> <next> <iface> <distance>   route changed
+ *   <time> <node> R- <dest>                             route removed
+ *   <time> <node> N+ <iface> <address> <lladdr> <state> neighbor added
+ *   <time> <node> N~ <iface> <address> <lladdr> <state> neighbor changed
+ *   <time> <node> N- <iface> <address>                  neighbor removed
+ *
+ * routes.py rebuilds a node's routing table or neighbor cache at any time
+ * from the journal.
+ *
+ * Usage:
+ *   RouteJournal journal;
+ *   journal.Open ("./scratch/myManet.journal");
+ *   journal.EnableOlsr (c);
+ *   journal.EnableNeighbors (c, Seconds (2));
+ *   ...
+ *   python scratch/routes.py table ./scratch/myManet.journal 26 30
+ */
+
+#ifndef ROUTE_JOURNAL_H
+#define ROUTE_JOURNAL_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/olsr-routing-protocol.h"
+
+#include "trace-binder.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+namespace ns3 {
+
+class RouteJournal
+{
+public:
+  RouteJournal ()
+    : m_lines (0),
+      m_interval (Seconds (2))
+  {
+  }
+
+  void Open (std::string fileName)
+  {
+    m_file.open (fileName.c_str (), std::ios::out);
+    NS_ABORT_MSG_UNLESS (m_file.is_open (), "Can't open " << fileName);
+    m_file.precision (9);
+    m_file << "# route journal 1: time node R+|R~|R-|N+|N~|N- ..." << '\n';
+  }
+
+  /*
+   * Journal the routing table of the OLSR instance of every node in
+   * 'nodes', standalone or inside an Ipv4ListRouting.
+   */
+  void EnableOlsr (NodeContainer nodes)
+  {
+    for (NodeContainer::Iterator n = nodes.Begin (); n != nodes.End (); ++n)
+      {
+        Ptr<olsr::RoutingProtocol> olsr = FindOlsr (*n);
+        NS_ABORT_MSG_UNLESS (olsr != 0, "Node " << (*n)->GetId () << " does not run OLSR");
+        Router *router = m_routers.Add (Router (this, (*n)->GetId (), olsr));
+        m_routers.Connect (olsr, "RoutingTableChanged", &RouteJournal::TableChanged, router);
+      }
+  }
+
+  // Journal the ARP caches of every node in 'nodes', read every 'interval'.
+  void EnableNeighbors (NodeContainer nodes, Time interval)
+  {
+    for (NodeContainer::Iterator n = nodes.Begin (); n != nodes.End (); ++n)
+      {
+        m_caches.push_back (NeighborCache ((*n)->GetId (), *n));
+      }
+    m_interval = interval;
+    Simulator::Schedule (interval, &RouteJournal::ReadNeighbors, this);
+  }
+
+  // The OLSR instance of 'node', standalone or in an Ipv4ListRouting, or 0.
+  static Ptr<olsr::RoutingProtocol> FindOlsr (Ptr<Node> node)
+  {
+    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+    if (ipv4 == 0)
+      {
+        return 0;
+      }
+    Ptr<Ipv4RoutingProtocol> proto = ipv4->GetRoutingProtocol ();
+    Ptr<olsr::RoutingProtocol> olsr = DynamicCast<olsr::RoutingProtocol> (proto);
+    Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting> (proto);
+    for (uint32_t i = 0; olsr == 0 && list != 0 && i < list->GetNRoutingProtocols (); ++i)
+      {
+        int16_t priority;
+        olsr = DynamicCast<olsr::RoutingProtocol> (list->GetRoutingProtocol (i, priority));
+      }
+    return olsr;
+  }
+
+  // Lines written so far.
+  uint64_t GetLines (void) const
+  {
+    return m_lines;
+  }
+
+  void Close (void)
+  {
+    m_file.close ();
+  }
+
+private:
+  typedef std::map<Ipv4Address, olsr::RoutingTableEntry> Table;
+
+  struct Router
+  {
+    Router (RouteJournal *j, uint32_t id, Ptr<olsr::RoutingProtocol> p)
+      : journal (j),
+        nodeId (id),
+        olsr (p)
+    {
+    }
+
+    RouteJournal *journal;
+    uint32_t nodeId;
+    Ptr<olsr::RoutingProtocol> olsr;
+    Table table;
+  };
+
+  // per interface, address -> "lladdr state"
+  typedef std::map<uint32_t, std::map<std::string, std::string> > Neighbors;
+
+  struct NeighborCache
+  {
+    NeighborCache (uint32_t id, Ptr<Node> n)
+      : nodeId (id),
+        node (n)
+    {
+    }
+
+    uint32_t nodeId;
+    Ptr<Node> node;
+    Neighbors neighbors;
+  };
+
+  static void TableChanged (Router *router, uint32_t size)
+  {
+    router->journal->DiffRoutes (*router);
+  }
+
+  void DiffRoutes (Router &router)
+  {
+    if (!m_file.is_open ())
+      {
+        return;
+      }
+    std::vector<olsr::RoutingTableEntry> entries = router.olsr->GetRoutingTableEntries ();
+    Table table;
+    for (std::vector<olsr::RoutingTableEntry>::const_iterator e = entries.begin (); e != entries.end (); ++e)
+      {
+        table[e->destAddr] = *e;
+      }
+    for (Table::const_iterator e = table.begin (); e != table.end (); ++e)
+      {
+        Table::const_iterator old = router.table.find (e->first);
+        if (old == router.table.end ())
+          {
+            WriteRoute (router.nodeId, "R+", e->second);
+          }
+        else if (old->second.nextAddr != e->second.nextAddr
+                 || old->second.interface != e->second.interface
+                 || old->second.distance != e->second.distance)
+          {
+            WriteRoute (router.nodeId, "R~", e->second);
+          }
+      }
+    for (Table::const_iterator old = router.table.begin (); old != router.table.end (); ++old)
+      {
+        if (table.find (old->first) == table.end ())
+          {
+            Line (router.nodeId) << " R- " << old->first << '\n';
+          }
+      }
+    router.table.swap (table);
+  }
+
+  void WriteRoute (uint32_t nodeId, const char *op, const olsr::RoutingTableEntry &e)
+  {
+    Line (nodeId) << " " << op << " " << e.destAddr << " " << e.nextAddr
+                  << " " << e.interface << " " << e.distance << '\n';
+  }
+
+  void ReadNeighbors (void)
+  {
+    if (!m_file.is_open ())
+      {
+        return;
+      }
+    for (std::deque<NeighborCache>::iterator c = m_caches.begin (); c != m_caches.end (); ++c)
+      {
+        DiffNeighbors (*c);
+      }
+    Simulator::Schedule (m_interval, &RouteJournal::ReadNeighbors, this);
+  }
+
+  /*
+   * ArpCache has no iterator, so its PrintArpCache lines
+   * ("<address> dev <n> lladdr <mac> <STATE>") are parsed.
+   */
+  void DiffNeighbors (NeighborCache &cache)
+  {
+    Ptr<Ipv4L3Protocol> ipv4 = cache.node->GetObject<Ipv4L3Protocol> ();
+    if (ipv4 == 0)
+      {
+        return;
+      }
+    Neighbors now;
+    for (uint32_t i = 0; i < ipv4->GetNInterfaces (); ++i)
+      {
+        Ptr<ArpCache> arp = ipv4->GetInterface (i)->GetArpCache ();
+        if (arp == 0)
+          {
+            continue;
+          }
+        std::ostringstream oss;
+        arp->PrintArpCache (Create<OutputStreamWrapper> (&oss));
+        std::istringstream lines (oss.str ());
+        std::string line;
+        while (std::getline (lines, line))
+          {
+            std::istringstream fields (line);
+            std::string address, dev, devIndex, lladdr, mac, state;
+            if (!(fields >> address >> dev >> devIndex))
+              {
+                continue;
+              }
+            if (fields >> lladdr && lladdr == "lladdr")
+              {
+                fields >> mac >> state;
+              }
+            else
+              {
+                // incomplete entries have no lladdr
+                state = lladdr;
+                mac = "-";
+              }
+            now[i][address] = mac + " " + state;
+          }
+      }
+    for (Neighbors::const_iterator itf = now.begin (); itf != now.end (); ++itf)
+      {
+        const std::map<std::string, std::string> &before = cache.neighbors[itf->first];
+        for (std::map<std::string, std::string>::const_iterator n = itf->second.begin (); n != itf->second.end (); ++n)
+          {
+            std::map<std::string, std::string>::const_iterator old = before.find (n->first);
+            if (old == before.end () || old->second != n->second)
+              {
+                Line (cache.nodeId) << (old == before.end () ? " N+ " : " N~ ") << itf->first
+                                    << " " << n->first << " " << n->second << '\n';
+              }
+          }
+      }
+    for (Neighbors::const_iterator itf = cache.neighbors.begin (); itf != cache.neighbors.end (); ++itf)
+      {
+        Neighbors::const_iterator after = now.find (itf->first);
+        for (std::map<std::string, std::string>::const_iterator old = itf->second.begin (); old != itf->second.end (); ++old)
+          {
+            if (after == now.end () || after->second.find (old->first) == after->second.end ())
+              {
+                Line (cache.nodeId) << " N- " << itf->first << " " << old->first << '\n';
+              }
+          }
+      }
+    cache.neighbors.swap (now);
+  }
+
+  std::ostream &Line (uint32_t nodeId)
+  {
+    m_lines++;
+    m_file << Simulator::Now ().GetSeconds () << " " << nodeId;
+    return m_file;
+  }
+
+  std::ofstream m_file;
+  uint64_t m_lines;
+  Time m_interval;
+  TraceSinks<Router> m_routers;
+  std::deque<NeighborCache> m_caches;
+};
+
+} // namespace ns3
+
+#endif /* ROUTE_JOURNAL_H */
@@ -0,0 +1,97 @@
+#!/usr/bin/env python
+#
+# Query a route journal (see route-journal.h).
+#
+#   python scratch/routes.py table scratch/myManet.journal 26 30
+#       node 26's OLSR routing table at t = 30 s, in the layout of
+#       PrintRoutingTableAllEvery
+#
+#   python scratch/routes.py neighbors scratch/myManet.journal 26 30
+#       node 26's ARP caches at t = 30 s
+#
+#   python scratch/routes.py history scratch/myManet.journal 26 [dest]
+#       every change of node 26's routes, or of its route to 'dest'
+#
+# .gz journals are read directly.
+#
+
+from __future__ import print_function
+
+import argparse
+import gzip
+
+
+def open_journal(name):
+    if name.endswith(".gz"):
+        return gzip.open(name, "rt")
+    return open(name)
+
+
+def changes(name, node):
+    """Yield (time, op, fields) of 'node', in journal order."""
+    with open_journal(name) as f:
+        for line in f:
+            if line.startswith("#"):
+                continue
+            fields = line.split()
+            if len(fields) < 3 or int(fields[1]) != node:
+                continue
+            yield float(fields[0]), fields[2], fields[3:]
+
+
+def table(name, node, at):
+    routes = {}
+    for t, op, fields in changes(name, node):
+        if t > at:
+            break
+        if op in ("R+", "R~"):
+            routes[fields[0]] = fields[1:]
+        elif op == "R-":
+            routes.pop(fields[0], None)
+    print("Node: {0}, Time: {1}, OLSR Routing table".format(node, "end" if at == float("inf") else "{0}s".format(at)))
+    print("Destination\t\tNextHop\t\tInterface\tDistance")
+    for dest in sorted(routes, key=lambda a: [int(x) for x in a.split(".")]):
+        next_hop, iface, distance = routes[dest]
+        print("{0}\t\t{1}\t\t{2}\t\t{3}".format(dest, next_hop, iface, distance))
+
+
+def neighbors(name, node, at):
+    cache = {}
+    for t, op, fields in changes(name, node):
+        if t > at:
+            break
+        if op in ("N+", "N~"):
+            cache[(int(fields[0]), fields[1])] = fields[2:]
+        elif op == "N-":
+            cache.pop((int(fields[0]), fields[1]), None)
+    print("ARP Cache of node {0} at time {1}".format(node, "end" if at == float("inf") else at))
+    for (iface, address), (lladdr, state) in sorted(cache.items()):
+        print("{0} dev {1} lladdr {2} {3}".format(address, iface, lladdr, state))
+
+
+def history(name, node, dest):
+    for t, op, fields in changes(name, node):
+        if op.startswith("R") and (dest is None or fields[0] == dest):
+            print(t, op, " ".join(fields))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="query a route journal")
+    parser.add_argument("query", choices=["table", "neighbors", "history"])
+    parser.add_argument("journal")
+    parser.add_argument("node", type=int)
+    parser.add_argument("arg", nargs="?", help="time in seconds, or destination for history")
+    opts = parser.parse_args()
+
+    if opts.query == "history":
+        history(opts.journal, opts.node, opts.arg)
+    else:
+        at = float(opts.arg) if opts.arg is not None else float("inf")
+        if opts.query == "table":
+            table(opts.journal, opts.node, at)
+        else:
+            neighbors(opts.journal, opts.node, at)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,886 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Scenarios described in a text file instead of a main ().
+ *
+ * The apcsmaext, adhocsubnet, stamesh and wifi-simple-adhoc programs
+ * differ in their node groups, links, mobility, routing and traffic, not
+ * in the code that builds them.  ScenarioLoader reads those from a file
+ * and builds them with one helper call per statement, so a variant is a
+ * new file (or a --name=value override of a variable), not a new program
+ * to compile; scenario.cc runs any of them.
+ *
+ * One statement per line, '#' starts a comment, ${name} is replaced by a
+ * variable.  Words are positional, key=value pairs are options:
+ *
+ *   var NAME VALUE                 a variable, unless set by Override
+ *   nodes GROUP COUNT              COUNT new nodes, in file order
+ *   wifi SEL mode=adhoc|ap|sta ssid= standard=b|g|a|n2.4|n5 rate=MODE
+ *        rts=BYTES txPower=DBM ed=DBM cca=DBM channel=NAME
+ *        loss=logdistance|friis net=NET
+ *   csma SEL rate=100Mbps delay=6560ns net=NET
+ *   p2p SEL SEL rate=5Mbps delay=2ms net=NET
+ *   mesh SEL interfaces=1 net=NET
+ *   mobility SEL grid x0= y0= dx= dy= width=    (width=0: square grid)
+ *   mobility SEL list at=X,Y[,Z];X,Y[,Z];...
+ *   mobility SEL random-rect bounds=XMIN,XMAX,YMIN,YMAX
+ *   mobility SEL random-walk bounds=XMIN,XMAX,YMIN,YMAX speed=MIN,MAX
+ *   internet SEL routing=global|static|olsr|aodv|dsdv
+ *   app echo from=SEL to=SEL port= size= count= interval= start= stop=
+ *   app onoff from=SEL to=SEL port= rate= size= proto=udp|tcp start= stop=
+ *   app batch from=SEL to=SEL port= size= count= interval=
+ *        model=constant|poisson start=
+ *   monitor flow summary=FILE
+ *   monitor pcap file=FILE
+ *   monitor anim file=FILE stop=
+ *   monitor routes file=FILE
+ *   stop SECONDS
+ *
+ * SEL names nodes: 'sta', 'sta:2', 'sta:0-3', or a comma-separated list
+ * of those.  Wifi devices with the same channel= share a channel, whose
+ * loss model (YansWifiChannelHelper's LogDistance by default) is set by
+ * the statement that creates it; ed= and cca= set the PHY's
+ * EnergyDetectionThreshold and CcaMode1Threshold.  The
+ * devices of all links with the same net= (a.b.c.d/len, default
+ * 10.1.1.0/24) form one subnet, addressed in the order they were
+ * installed.  Apps send from every 'from' node to the 'to' node of the
+ * same index, modulo the number of 'to' nodes, on the address of its
+ * first interface.
+ *
+ * The file is built in phases, whatever the order of its statements:
+ * nodes, links, mobility (ConstantPosition at the origin for nodes left
+ * out), internet stacks (global routing for nodes left out), addresses,
+ * apps, monitors.  Errors abort with the file name and line.
+ *
+ * Usage:
+ *   ScenarioLoader scenario;
+ *   scenario.Override ("numNodes", "49");
+ *   scenario.Load ("adhoc-grid.scn");
+ *   scenario.Build ();
+ *   scenario.Run ();
+ */
+
+#ifndef SCENARIO_LOADER_H
+#define SCENARIO_LOADER_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/mesh-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/olsr-module.h"
+#include "ns3/aodv-module.h"
+#include "ns3/dsdv-module.h"
+#include "ns3/flow-monitor-module.h"
+
+#include "batch-traffic-generator.h"
+#include "seq-ts-sink.h"
+#include "flow-summary.h"
+#include "pcap-capture.h"
+#include "anim-recorder.h"
+#include "route-journal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+// Abort with the file and line of statement 'st'.
+#define SCENARIO_REQUIRE(st, cond, msg) \
+  NS_ABORT_MSG_UNLESS (cond, m_fileName << ":" << (st).line << ": " << msg)
+
+namespace ns3 {
+
+class ScenarioLoader
+{
+public:
+  ScenarioLoader ()
+    : m_stop (Seconds (10)),
+      m_tracing (true),
+      m_globalRouting (false),
+      m_flowMonitor (false),
+      m_anim (0)
+  {
+  }
+
+  ~ScenarioLoader ()
+  {
+    delete m_anim;
+  }
+
+  // Set variable 'name', overriding its var statement.  Call before Load.
+  void Override (std::string name, std::string value)
+  {
+    m_overrides[name] = value;
+  }
+
+  // Write the FlowSummary rows here, with or without a flow monitor statement.
+  void SetSummary (std::string fileName)
+  {
+    m_summary = fileName;
+  }
+
+  // Without tracing the pcap, anim and routes monitors are skipped.
+  void SetTracing (bool tracing)
+  {
+    m_tracing = tracing;
+  }
+
+  void Load (std::string fileName)
+  {
+    std::ifstream in (fileName.c_str ());
+    NS_ABORT_MSG_UNLESS (in.is_open (), "Can't open " << fileName);
+    m_fileName = fileName;
+    m_vars = m_overrides;
+    std::set<std::string> declared;
+    std::string text;
+    uint32_t lineNo = 0;
+    while (std::getline (in, text))
+      {
+        lineNo++;
+        text = Substitute (text.substr (0, text.find ('#')), lineNo);
+        Statement st;
+        st.line = lineNo;
+        std::istringstream fields (text);
+        std::string word;
+        while (fields >> word)
+          {
+            size_t eq = word.find ('=');
+            if (st.kind.empty ())
+              {
+                st.kind = word;
+              }
+            else if (eq == std::string::npos)
+              {
+                st.words.push_back (word);
+              }
+            else
+              {
+                st.options[word.substr (0, eq)] = word.substr (eq + 1);
+              }
+          }
+        if (st.kind.empty ())
+          {
+            continue;
+          }
+        if (st.kind == "var")
+          {
+            SCENARIO_REQUIRE (st, st.words.size () == 2, "var takes a name and a value");
+            declared.insert (st.words[0]);
+            if (m_vars.find (st.words[0]) == m_vars.end ())
+              {
+                m_vars[st.words[0]] = st.words[1];
+              }
+            continue;
+          }
+        if (st.kind == "stop")
+          {
+            SCENARIO_REQUIRE (st, st.words.size () == 1, "stop takes the time in seconds");
+            m_stop = Seconds (Number (st, st.words[0]));
+            continue;
+          }
+        SCENARIO_REQUIRE (st, st.kind == "nodes" || st.kind == "wifi" || st.kind == "csma" || st.kind == "p2p"
+                          || st.kind == "mesh" || st.kind == "mobility" || st.kind == "internet"
+                          || st.kind == "app" || st.kind == "monitor", "unknown statement '" << st.kind << "'");
+        m_statements.push_back (st);
+      }
+    for (std::map<std::string, std::string>::const_iterator o = m_overrides.begin (); o != m_overrides.end (); ++o)
+      {
+        NS_ABORT_MSG_UNLESS (declared.count (o->first) > 0, fileName << " has no variable '" << o->first << "'");
+      }
+  }
+
+  void Build (void)
+  {
+    Phase ("nodes", &ScenarioLoader::BuildNodes);
+    Phase ("wifi", &ScenarioLoader::BuildWifi);
+    Phase ("csma", &ScenarioLoader::BuildCsma);
+    Phase ("p2p", &ScenarioLoader::BuildP2p);
+    Phase ("mesh", &ScenarioLoader::BuildMesh);
+    Phase ("mobility", &ScenarioLoader::BuildMobility);
+    NodeContainer unplaced;
+    for (NodeContainer::Iterator n = m_all.Begin (); n != m_all.End (); ++n)
+      {
+        if ((*n)->GetObject<MobilityModel> () == 0)
+          {
+            unplaced.Add (*n);
+          }
+      }
+    MobilityHelper mobility;
+    mobility.Install (unplaced);
+    Phase ("internet", &ScenarioLoader::BuildInternet);
+    NodeContainer unstacked;
+    for (NodeContainer::Iterator n = m_all.Begin (); n != m_all.End (); ++n)
+      {
+        if ((*n)->GetObject<Ipv4> () == 0)
+          {
+            unstacked.Add (*n);
+            m_globalRouting = true;
+          }
+      }
+    InternetStackHelper internet;
+    internet.Install (unstacked);
+    for (std::vector<std::string>::const_iterator net = m_netOrder.begin (); net != m_netOrder.end (); ++net)
+      {
+        size_t slash = net->find ('/');
+        Ipv4AddressHelper address;
+        address.SetBase (Ipv4Address (net->substr (0, slash).c_str ()),
+                         Ipv4Mask (slash == std::string::npos ? "/24" : net->substr (slash).c_str ()));
+        address.Assign (m_nets[*net]);
+      }
+    if (m_globalRouting)
+      {
+        Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+      }
+    Phase ("app", &ScenarioLoader::BuildApp);
+    Phase ("monitor", &ScenarioLoader::BuildMonitor);
+    if (!m_summary.empty () && !m_flowMonitor)
+      {
+        m_monitor = m_flowHelper.InstallAll ();
+        m_flowMonitor = true;
+      }
+  }
+
+  // Run until the stop time, then write the summary and close the monitors.
+  void Run (void)
+  {
+    Simulator::Stop (m_stop);
+    Simulator::Run ();
+    if (!m_summary.empty ())
+      {
+        FlowSummary::Write (m_monitor, m_flowHelper, m_summary);
+      }
+    m_capture.Close ();
+    m_journal.Close ();
+    if (m_anim != 0)
+      {
+        m_anim->Close ();
+      }
+  }
+
+  NodeContainer GetGroup (std::string name) const
+  {
+    std::map<std::string, NodeContainer>::const_iterator g = m_groups.find (name);
+    NS_ABORT_MSG_UNLESS (g != m_groups.end (), m_fileName << " has no node group '" << name << "'");
+    return g->second;
+  }
+
+  // Groups with their node ids, and subnets with their device count.
+  void Print (std::ostream &os) const
+  {
+    for (std::vector<std::string>::const_iterator g = m_groupOrder.begin (); g != m_groupOrder.end (); ++g)
+      {
+        NodeContainer nodes = GetGroup (*g);
+        os << "group " << *g << ": nodes " << nodes.Get (0)->GetId () << ".."
+           << nodes.Get (nodes.GetN () - 1)->GetId () << "\n";
+      }
+    for (std::vector<std::string>::const_iterator net = m_netOrder.begin (); net != m_netOrder.end (); ++net)
+      {
+        os << "net " << *net << ": " << m_nets.find (*net)->second.GetN () << " devices\n";
+      }
+    os << "stop " << m_stop.GetSeconds () << " s\n";
+  }
+
+private:
+  struct Statement
+  {
+    uint32_t line;
+    std::string kind;
+    std::vector<std::string> words;
+    std::map<std::string, std::string> options;
+  };
+
+  typedef void (ScenarioLoader::*Builder) (const Statement &st);
+
+  void Phase (std::string kind, Builder builder)
+  {
+    for (std::vector<Statement>::const_iterator st = m_statements.begin (); st != m_statements.end (); ++st)
+      {
+        if (st->kind == kind)
+          {
+            (this->*builder) (*st);
+          }
+      }
+  }
+
+  void BuildNodes (const Statement &st)
+  {
+    SCENARIO_REQUIRE (st, st.words.size () == 2, "nodes takes a group name and a count");
+    SCENARIO_REQUIRE (st, m_groups.find (st.words[0]) == m_groups.end (), "group '" << st.words[0] << "' defined twice");
+    NodeContainer nodes;
+    nodes.Create (Unsigned (st, st.words[1]));
+    m_groups[st.words[0]] = nodes;
+    m_groupOrder.push_back (st.words[0]);
+    m_all.Add (nodes);
+  }
+
+  void BuildWifi (const Statement &st)
+  {
+    Check (st, "mode ssid standard rate rts txPower ed cca channel loss net");
+    SCENARIO_REQUIRE (st, st.words.size () == 1, "wifi takes one node selection");
+    std::string channel = Option (st, "channel", "default");
+    std::string loss = Option (st, "loss", "logdistance");
+    if (m_channels.find (channel) == m_channels.end ())
+      {
+        YansWifiChannelHelper helper;
+        helper.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+        if (loss == "logdistance")
+          {
+            helper.AddPropagationLoss ("ns3::LogDistancePropagationLossModel");
+          }
+        else if (loss == "friis")
+          {
+            helper.AddPropagationLoss ("ns3::FriisPropagationLossModel");
+          }
+        else
+          {
+            SCENARIO_REQUIRE (st, false, "unknown loss model '" << loss << "'");
+          }
+        m_channels[channel] = helper.Create ();
+        m_channelLoss[channel] = loss;
+      }
+    SCENARIO_REQUIRE (st, st.options.count ("loss") == 0 || m_channelLoss[channel] == loss,
+                      "channel '" << channel << "' already uses loss=" << m_channelLoss[channel]);
+    YansWifiPhyHelper phy = YansWifiPhyHelper::Default ();
+    phy.SetChannel (m_channels[channel]);
+    if (st.options.count ("txPower") > 0)
+      {
+        phy.Set ("TxPowerStart", DoubleValue (Number (st, st.options.find ("txPower")->second)));
+        phy.Set ("TxPowerEnd", DoubleValue (Number (st, st.options.find ("txPower")->second)));
+      }
+    if (st.options.count ("ed") > 0)
+      {
+        phy.Set ("EnergyDetectionThreshold", DoubleValue (Number (st, st.options.find ("ed")->second)));
+      }
+    if (st.options.count ("cca") > 0)
+      {
+        phy.Set ("CcaMode1Threshold", DoubleValue (Number (st, st.options.find ("cca")->second)));
+      }
+    std::string standard = Option (st, "standard", "b");
+    WifiHelper wifi;
+    if (standard == "a")
+      {
+        wifi.SetStandard (WIFI_PHY_STANDARD_80211a);
+      }
+    else if (standard == "b")
+      {
+        wifi.SetStandard (WIFI_PHY_STANDARD_80211b);
+      }
+    else if (standard == "g")
+      {
+        wifi.SetStandard (WIFI_PHY_STANDARD_80211g);
+      }
+    else if (standard == "n2.4")
+      {
+        wifi.SetStandard (WIFI_PHY_STANDARD_80211n_2_4GHZ);
+      }
+    else if (standard == "n5")
+      {
+        wifi.SetStandard (WIFI_PHY_STANDARD_80211n_5GHZ);
+      }
+    else
+      {
+        SCENARIO_REQUIRE (st, false, "unknown wifi standard '" << standard << "'");
+      }
+    if (st.options.count ("rate") > 0)
+      {
+        std::string rate = st.options.find ("rate")->second;
+        wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
+                                      "DataMode", StringValue (rate),
+                                      "ControlMode", StringValue (rate),
+                                      "NonUnicastMode", StringValue (rate),
+                                      "RtsCtsThreshold", UintegerValue (Unsigned (st, Option (st, "rts", "65535"))));
+      }
+    else
+      {
+        wifi.SetRemoteStationManager ("ns3::ArfWifiManager",
+                                      "RtsCtsThreshold", UintegerValue (Unsigned (st, Option (st, "rts", "65535"))));
+      }
+    WifiMacHelper mac;
+    std::string mode = Option (st, "mode", "adhoc");
+    Ssid ssid (Option (st, "ssid", "ns-3-ssid"));
+    if (mode == "adhoc")
+      {
+        mac.SetType ("ns3::AdhocWifiMac");
+      }
+    else if (mode == "ap")
+      {
+        mac.SetType ("ns3::ApWifiMac", "Ssid", SsidValue (ssid));
+      }
+    else if (mode == "sta")
+      {
+        mac.SetType ("ns3::StaWifiMac", "Ssid", SsidValue (ssid), "ActiveProbing", BooleanValue (false));
+      }
+    else
+      {
+        SCENARIO_REQUIRE (st, false, "unknown wifi mode '" << mode << "'");
+      }
+    AddDevices (st, wifi.Install (phy, mac, Select (st, st.words[0])));
+  }
+
+  void BuildCsma (const Statement &st)
+  {
+    Check (st, "rate delay net");
+    SCENARIO_REQUIRE (st, st.words.size () == 1, "csma takes one node selection");
+    CsmaHelper csma;
+    csma.SetChannelAttribute ("DataRate", StringValue (Option (st, "rate", "100Mbps")));
+    csma.SetChannelAttribute ("Delay", StringValue (Option (st, "delay", "6560ns")));
+    AddDevices (st, csma.Install (Select (st, st.words[0])));
+  }
+
+  void BuildP2p (const Statement &st)
+  {
+    Check (st, "rate delay net");
+    SCENARIO_REQUIRE (st, st.words.size () == 2, "p2p takes two node selections");
+    NodeContainer a = Select (st, st.words[0]);
+    NodeContainer b = Select (st, st.words[1]);
+    SCENARIO_REQUIRE (st, a.GetN () == 1 && b.GetN () == 1, "p2p links two single nodes");
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute ("DataRate", StringValue (Option (st, "rate", "5Mbps")));
+    p2p.SetChannelAttribute ("Delay", StringValue (Option (st, "delay", "2ms")));
+    AddDevices (st, p2p.Install (a.Get (0), b.Get (0)));
+  }
+
+  void BuildMesh (const Statement &st)
+  {
+    Check (st, "interfaces net");
+    SCENARIO_REQUIRE (st, st.words.size () == 1, "mesh takes one node selection");
+    if (m_channels.find ("mesh") == m_channels.end ())
+      {
+        m_channels["mesh"] = YansWifiChannelHelper::Default ().Create ();
+        m_channelLoss["mesh"] = "logdistance";
+      }
+    YansWifiPhyHelper phy = YansWifiPhyHelper::Default ();
+    phy.SetChannel (m_channels["mesh"]);
+    MeshHelper mesh = MeshHelper::Default ();
+    mesh.SetStackInstaller ("ns3::Dot11sStack");
+    mesh.SetSpreadInterfaceChannels (MeshHelper::SPREAD_CHANNELS);
+    mesh.SetNumberOfInterfaces (Unsigned (st, Option (st, "interfaces", "1")));
+    AddDevices (st, mesh.Install (phy, Select (st, st.words[0])));
+  }
+
+  void BuildMobility (const Statement &st)
+  {
+    SCENARIO_REQUIRE (st, st.words.size () == 2, "mobility takes a node selection and a model");
+    NodeContainer nodes = Select (st, st.words[0]);
+    std::string model = st.words[1];
+    MobilityHelper mobility;
+    if (model == "grid")
+      {
+        Check (st, "x0 y0 dx dy width");
+        uint32_t width = Unsigned (st, Option (st, "width", "0"));
+        if (width == 0)
+          {
+            width = static_cast<uint32_t> (std::ceil (std::sqrt (nodes.GetN ())));
+          }
+        mobility.SetPositionAllocator ("ns3::GridPositionAllocator",
+                                       "MinX", DoubleValue (Number (st, Option (st, "x0", "0"))),
+                                       "MinY", DoubleValue (Number (st, Option (st, "y0", "0"))),
+                                       "DeltaX", DoubleValue (Number (st, Option (st, "dx", "10"))),
+                                       "DeltaY", DoubleValue (Number (st, Option (st, "dy", "10"))),
+                                       "GridWidth", UintegerValue (width),
+                                       "LayoutType", StringValue ("RowFirst"));
+      }
+    else if (model == "list")
+      {
+        Check (st, "at");
+        Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator> ();
+        std::vector<std::string> points = Split (Option (st, "at", ""), ';');
+        SCENARIO_REQUIRE (st, points.size () == nodes.GetN (), "at= has " << points.size () << " positions for " << nodes.GetN () << " nodes");
+        for (std::vector<std::string>::const_iterator p = points.begin (); p != points.end (); ++p)
+          {
+            std::vector<double> xyz = Numbers (st, *p);
+            SCENARIO_REQUIRE (st, xyz.size () == 2 || xyz.size () == 3, "position '" << *p << "' is not X,Y[,Z]");
+            positions->Add (Vector (xyz[0], xyz[1], xyz.size () == 3 ? xyz[2] : 0.0));
+          }
+        mobility.SetPositionAllocator (positions);
+      }
+    else if (model == "random-rect" || model == "random-walk")
+      {
+        Check (st, model == "random-walk" ? "bounds speed" : "bounds");
+        std::vector<double> b = Numbers (st, Option (st, "bounds", "0,100,0,100"));
+        SCENARIO_REQUIRE (st, b.size () == 4, "bounds= is XMIN,XMAX,YMIN,YMAX");
+        std::ostringstream x, y;
+        x << "ns3::UniformRandomVariable[Min=" << b[0] << "|Max=" << b[1] << "]";
+        y << "ns3::UniformRandomVariable[Min=" << b[2] << "|Max=" << b[3] << "]";
+        mobility.SetPositionAllocator ("ns3::RandomRectanglePositionAllocator",
+                                       "X", StringValue (x.str ()),
+                                       "Y", StringValue (y.str ()));
+        if (model == "random-walk")
+          {
+            std::vector<double> s = Numbers (st, Option (st, "speed", "2,4"));
+            SCENARIO_REQUIRE (st, s.size () == 2, "speed= is MIN,MAX");
+            std::ostringstream speed;
+            speed << "ns3::UniformRandomVariable[Min=" << s[0] << "|Max=" << s[1] << "]";
+            mobility.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
+                                       "Bounds", RectangleValue (Rectangle (b[0], b[1], b[2], b[3])),
+                                       "Speed", StringValue (speed.str ()),
+                                       "Direction", StringValue ("ns3::UniformRandomVariable[Min=0.0|Max=6.283184]"));
+          }
+      }
+    else
+      {
+        SCENARIO_REQUIRE (st, false, "unknown mobility model '" << model << "'");
+      }
+    mobility.Install (nodes);
+  }
+
+  void BuildInternet (const Statement &st)
+  {
+    Check (st, "routing");
+    SCENARIO_REQUIRE (st, st.words.size () == 1, "internet takes one node selection");
+    std::string routing = Option (st, "routing", "global");
+    InternetStackHelper internet;
+    Ipv4StaticRoutingHelper staticRouting;
+    Ipv4ListRoutingHelper list;
+    OlsrHelper olsr;
+    AodvHelper aodv;
+    DsdvHelper dsdv;
+    list.Add (staticRouting, 0);
+    if (routing == "olsr")
+      {
+        list.Add (olsr, 10);
+      }
+    else if (routing == "aodv")
+      {
+        list.Add (aodv, 10);
+      }
+    else if (routing == "dsdv")
+      {
+        list.Add (dsdv, 10);
+      }
+    else if (routing == "global")
+      {
+        m_globalRouting = true;
+      }
+    else
+      {
+        SCENARIO_REQUIRE (st, routing == "static", "unknown routing '" << routing << "'");
+      }
+    if (routing != "global")
+      {
+        internet.SetRoutingHelper (list);
+      }
+    internet.Install (Select (st, st.words[0]));
+  }
+
+  void BuildApp (const Statement &st)
+  {
+    SCENARIO_REQUIRE (st, st.words.size () == 1, "app takes a type");
+    std::string type = st.words[0];
+    NodeContainer from = Select (st, Option (st, "from", ""));
+    NodeContainer to = Select (st, Option (st, "to", ""));
+    uint16_t port = Unsigned (st, Option (st, "port", "9"));
+    Time start = Seconds (Number (st, Option (st, "start", "1")));
+    Time stop = Seconds (Number (st, Option (st, "stop", "0")));
+    if (stop.IsZero ())
+      {
+        stop = m_stop;
+      }
+    if (type == "echo")
+      {
+        Check (st, "from to port size count interval start stop");
+        UdpEchoServerHelper server (port);
+        ApplicationContainer servers = server.Install (to);
+        servers.Start (Seconds (0));
+        servers.Stop (stop);
+        for (uint32_t i = 0; i < from.GetN (); ++i)
+          {
+            UdpEchoClientHelper client (AddressOf (to.Get (i % to.GetN ())), port);
+            client.SetAttribute ("MaxPackets", UintegerValue (Unsigned (st, Option (st, "count", "1"))));
+            client.SetAttribute ("Interval", TimeValue (Seconds (Number (st, Option (st, "interval", "1")))));
+            client.SetAttribute ("PacketSize", UintegerValue (Unsigned (st, Option (st, "size", "1024"))));
+            ApplicationContainer clients = client.Install (from.Get (i));
+            clients.Start (start);
+            clients.Stop (stop);
+          }
+      }
+    else if (type == "onoff")
+      {
+        Check (st, "from to port rate size proto start stop");
+        std::string proto = Option (st, "proto", "udp");
+        SCENARIO_REQUIRE (st, proto == "udp" || proto == "tcp", "proto is udp or tcp");
+        std::string factory = proto == "udp" ? "ns3::UdpSocketFactory" : "ns3::TcpSocketFactory";
+        PacketSinkHelper sink (factory, InetSocketAddress (Ipv4Address::GetAny (), port));
+        ApplicationContainer sinks = sink.Install (to);
+        sinks.Start (Seconds (0));
+        sinks.Stop (stop);
+        for (uint32_t i = 0; i < from.GetN (); ++i)
+          {
+            OnOffHelper onoff (factory, InetSocketAddress (AddressOf (to.Get (i % to.GetN ())), port));
+            onoff.SetConstantRate (DataRate (Option (st, "rate", "500kbps")),
+                                   Unsigned (st, Option (st, "size", "512")));
+            ApplicationContainer sources = onoff.Install (from.Get (i));
+            sources.Start (start);
+            sources.Stop (stop);
+          }
+      }
+    else if (type == "batch")
+      {
+        Check (st, "from to port size count interval model start");
+        std::string model = Option (st, "model", "constant");
+        SCENARIO_REQUIRE (st, model == "constant" || model == "poisson", "model is constant or poisson");
+        TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
+        for (uint32_t i = 0; i < to.GetN (); ++i)
+          {
+            Ptr<SeqTsSink> sink = CreateObject<SeqTsSink> ();
+            sink->SetAttribute ("Local", AddressValue (InetSocketAddress (Ipv4Address::GetAny (), port)));
+            to.Get (i)->AddApplication (sink);
+            sink->SetStartTime (Seconds (0));
+          }
+        // one generator for all the sources; it sends on each socket in the
+        // context of the socket's node
+        Ptr<BatchTrafficGenerator> traffic = CreateObject<BatchTrafficGenerator> ();
+        traffic->SetSeqTs (true);
+        for (uint32_t i = 0; i < from.GetN (); ++i)
+          {
+            Ptr<Socket> socket = Socket::CreateSocket (from.Get (i), tid);
+            socket->Connect (InetSocketAddress (AddressOf (to.Get (i % to.GetN ())), port));
+            uint32_t source = traffic->AddSource (socket, Unsigned (st, Option (st, "size", "1024")),
+                                                  Unsigned (st, Option (st, "count", "20")),
+                                                  Seconds (Number (st, Option (st, "interval", "0.1"))));
+            if (model == "poisson")
+              {
+                traffic->SetModel (source, BatchTrafficGenerator::POISSON);
+              }
+          }
+        from.Get (0)->AddApplication (traffic);
+        traffic->SetStartTime (start);
+      }
+    else
+      {
+        SCENARIO_REQUIRE (st, false, "unknown app '" << type << "'");
+      }
+  }
+
+  void BuildMonitor (const Statement &st)
+  {
+    SCENARIO_REQUIRE (st, st.words.size () == 1, "monitor takes a type");
+    std::string type = st.words[0];
+    if (type == "flow")
+      {
+        Check (st, "summary");
+        if (m_summary.empty ())
+          {
+            m_summary = Option (st, "summary", "");
+          }
+        if (!m_flowMonitor)
+          {
+            m_monitor = m_flowHelper.InstallAll ();
+            m_flowMonitor = true;
+          }
+      }
+    else if (type == "pcap")
+      {
+        Check (st, "file");
+        if (m_tracing)
+          {
+            m_capture.Open (Option (st, "file", "scenario.pcapng"));
+            m_capture.AddAll ();
+          }
+      }
+    else if (type == "anim")
+      {
+        Check (st, "file stop");
+        SCENARIO_REQUIRE (st, m_anim == 0, "one anim monitor per scenario");
+        if (m_tracing)
+          {
+            m_anim = new AnimRecorder (Option (st, "file", "scenario.anim"));
+            if (st.options.count ("stop") > 0)
+              {
+                m_anim->SetStopTime (Seconds (Number (st, st.options.find ("stop")->second)));
+              }
+          }
+      }
+    else if (type == "routes")
+      {
+        Check (st, "file");
+        if (m_tracing)
+          {
+            m_journal.Open (Option (st, "file", "scenario.journal"));
+            m_journal.EnableOlsr (m_all);
+            m_journal.EnableNeighbors (m_all, Seconds (2));
+          }
+      }
+    else
+      {
+        SCENARIO_REQUIRE (st, false, "unknown monitor '" << type << "'");
+      }
+  }
+
+  void AddDevices (const Statement &st, NetDeviceContainer devices)
+  {
+    std::string net = Option (st, "net", "10.1.1.0/24");
+    if (m_nets.find (net) == m_nets.end ())
+      {
+        m_netOrder.push_back (net);
+      }
+    m_nets[net].Add (devices);
+  }
+
+  // 'group', 'group:i', 'group:i-j', comma separated.
+  NodeContainer Select (const Statement &st, std::string selection) const
+  {
+    SCENARIO_REQUIRE (st, !selection.empty (), "missing node selection");
+    NodeContainer nodes;
+    std::vector<std::string> parts = Split (selection, ',');
+    for (std::vector<std::string>::const_iterator p = parts.begin (); p != parts.end (); ++p)
+      {
+        size_t colon = p->find (':');
+        std::map<std::string, NodeContainer>::const_iterator g = m_groups.find (p->substr (0, colon));
+        SCENARIO_REQUIRE (st, g != m_groups.end (), "no node group '" << p->substr (0, colon) << "'");
+        if (colon == std::string::npos)
+          {
+            nodes.Add (g->second);
+            continue;
+          }
+        std::string range = p->substr (colon + 1);
+        size_t dash = range.find ('-');
+        uint32_t first = Unsigned (st, range.substr (0, dash));
+        uint32_t last = dash == std::string::npos ? first : Unsigned (st, range.substr (dash + 1));
+        SCENARIO_REQUIRE (st, first <= last && last < g->second.GetN (), "'" << *p << "' is outside the group");
+        for (uint32_t i = first; i <= last; ++i)
+          {
+            nodes.Add (g->second.Get (i));
+          }
+      }
+    return nodes;
+  }
+
+  // Address of the node's first interface.
+  static Ipv4Address AddressOf (Ptr<Node> node)
+  {
+    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+    NS_ABORT_MSG_UNLESS (ipv4 != 0 && ipv4->GetNInterfaces () > 1, "Node " << node->GetId () << " has no address");
+    return ipv4->GetAddress (1, 0).GetLocal ();
+  }
+
+  std::string Substitute (std::string text, uint32_t lineNo) const
+  {
+    for (size_t open = text.find ("${"); open != std::string::npos; open = text.find ("${", open))
+      {
+        size_t close = text.find ('}', open);
+        NS_ABORT_MSG_UNLESS (close != std::string::npos, m_fileName << ":" << lineNo << ": unterminated ${");
+        std::string name = text.substr (open + 2, close - open - 2);
+        std::map<std::string, std::string>::const_iterator v = m_vars.find (name);
+        NS_ABORT_MSG_UNLESS (v != m_vars.end (), m_fileName << ":" << lineNo << ": no variable '" << name << "'");
+        text.replace (open, close + 1 - open, v->second);
+        open += v->second.size ();
+      }
+    return text;
+  }
+
+  // Abort on options the statement does not take, e.g. typos.
+  void Check (const Statement &st, std::string known) const
+  {
+    std::vector<std::string> keys = Split (known, ' ');
+    for (std::map<std::string, std::string>::const_iterator o = st.options.begin (); o != st.options.end (); ++o)
+      {
+        SCENARIO_REQUIRE (st, std::find (keys.begin (), keys.end (), o->first) != keys.end (),
+                          st.kind << " has no option '" << o->first << "'");
+      }
+  }
+
+  static std::string Option (const Statement &st, std::string key, std::string def)
+  {
+    std::map<std::string, std::string>::const_iterator o = st.options.find (key);
+    return o != st.options.end () ? o->second : def;
+  }
+
+  double Number (const Statement &st, std::string text) const
+  {
+    char *end = 0;
+    double value = std::strtod (text.c_str (), &end);
+    SCENARIO_REQUIRE (st, !text.empty () && *end == '\0', "'" << text << "' is not a number");
+    return value;
+  }
+
+  uint32_t Unsigned (const Statement &st, std::string text) const
+  {
+    double value = Number (st, text);
+    SCENARIO_REQUIRE (st, value >= 0 && value == std::floor (value), "'" << text << "' is not a count");
+    return static_cast<uint32_t> (value);
+  }
+
+  std::vector<double> Numbers (const Statement &st, std::string text) const
+  {
+    std::vector<double> values;
+    std::vector<std::string> parts = Split (text, ',');
+    for (std::vector<std::string>::const_iterator p = parts.begin (); p != parts.end (); ++p)
+      {
+        values.push_back (Number (st, *p));
+      }
+    return values;
+  }
+
+  static std::vector<std::string> Split (const std::string &text, char separator)
+  {
+    std::vector<std::string> parts;
+    std::istringstream is (text);
+    std::string part;
+    while (std::getline (is, part, separator))
+      {
+        if (!part.empty ())
+          {
+            parts.push_back (part);
+          }
+      }
+    return parts;
+  }
+
+  ScenarioLoader (const ScenarioLoader &);
+  ScenarioLoader &operator= (const ScenarioLoader &);
+
+  std::string m_fileName;
+  std::map<std::string, std::string> m_overrides;
+  std::map<std::string, std::string> m_vars;
+  std::vector<Statement> m_statements;
+  Time m_stop;
+  bool m_tracing;
+  std::string m_summary;
+  std::map<std::string, NodeContainer> m_groups;
+  std::vector<std::string> m_groupOrder;
+  NodeContainer m_all;
+  std::map<std::string, Ptr<YansWifiChannel> > m_channels;
+  std::map<std::string, std::string> m_channelLoss;
+  std::map<std::string, NetDeviceContainer> m_nets;
+  std::vector<std::string> m_netOrder;    // nets in the order addresses are assigned
+  bool m_globalRouting;
+  bool m_flowMonitor;
+  FlowMonitorHelper m_flowHelper;
+  Ptr<FlowMonitor> m_monitor;
+  PcapCapture m_capture;
+  RouteJournal m_journal;
+  AnimRecorder *m_anim;
+};
+
+} // namespace ns3
+
+#undef SCENARIO_REQUIRE
+
+#endif /* SCENARIO_LOADER_H */
@@ -0,0 +1,101 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Runs a scenario file (see scenario-loader.h).
+//
+//   ./waf --run "scenario --scenario=scratch/apcsmaext.scn"
+//   ./waf --run "scenario --scenario=scratch/adhoc-grid.scn --numNodes=100 --tracing=0"
+//
+// --name=value sets a 'var' of the file; --scenario, --summary, --tracing,
+// global values (--RngRun, ...) and attributes (--ns3::...) go to
+// CommandLine as usual.  With sweep.py:
+//
+//   python scratch/sweep.py --program=scenario --arg=--scenario=scratch/adhoc-grid.scn \
+//       --grid numNodes=25,49,100 interval=0.1,0.05
+//
+
+#include "ns3/core-module.h"
+
+#include "scenario-loader.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("Scenario");
+
+// Options of this program, of CommandLine itself, and global values.
+static bool
+IsCommandLineOption (std::string name)
+{
+  if (name == "scenario" || name == "summary" || name == "tracing"
+      || name.compare (0, 5, "Print") == 0 || name.find ("::") != std::string::npos)
+    {
+      return true;
+    }
+  for (GlobalValue::Iterator g = GlobalValue::Begin (); g != GlobalValue::End (); ++g)
+    {
+      if ((*g)->GetName () == name)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string scenarioFile = "";
+  std::string summary = "";
+  bool tracing = true;
+
+  ScenarioLoader scenario;
+  std::vector<char *> args;
+  args.push_back (argv[0]);
+  for (int i = 1; i < argc; ++i)
+    {
+      std::string arg = argv[i];
+      size_t eq = arg.find ('=');
+      if (arg.compare (0, 2, "--") == 0 && eq != std::string::npos && !IsCommandLineOption (arg.substr (2, eq - 2)))
+        {
+          scenario.Override (arg.substr (2, eq - 2), arg.substr (eq + 1));
+          continue;
+        }
+      args.push_back (argv[i]);
+    }
+
+  CommandLine cmd;
+  cmd.AddValue ("scenario", "scenario file to run", scenarioFile);
+  cmd.AddValue ("summary", "write a per-flow CSV summary to this file", summary);
+  cmd.AddValue ("tracing", "write the pcap, anim and routes monitors of the file", tracing);
+  cmd.Parse (args.size (), &args[0]);
+  NS_ABORT_MSG_UNLESS (!scenarioFile.empty (), "--scenario=FILE is required");
+
+  scenario.SetSummary (summary);
+  scenario.SetTracing (tracing);
+  scenario.Load (scenarioFile);
+  scenario.Build ();
+  scenario.Print (std::cout);
+
+  scenario.Run ();
+  Simulator::Destroy ();
+  return 0;
+}
@@ -0,0 +1,104 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Seeding of replications that are repeatable and never share random
+ * numbers.
+ *
+ * ns-3 draws every random variable from MRG32k3a.  RngSeed is the
+ * generator's seed, RngRun picks a substream (2^76 numbers apart) and the
+ * stream index of each variable (AssignStreams, or the next free index)
+ * picks a stream (2^127 apart).  Two processes with the same seed and
+ * different runs can therefore never draw the same numbers, whatever
+ * streams they use.  Two different seeds give no such guarantee, and a
+ * seed taken from the clock (as random.cc and on_off.cc did) is neither
+ * repeatable nor safe for jobs started in the same millisecond.
+ *
+ * So a study keeps one master seed for all its processes and gives every
+ * replication its own run:
+ *
+ *   Apply (seed, run)   checks and sets RngSeed and RngRun
+ *   Run (...)           the run of replication r of grid point p; with
+ *                       'common' the points share runs (common random
+ *                       numbers between configurations), otherwise each
+ *                       (point, replication) has its own
+ *   Fresh ()            a run from /dev/urandom, for a one-off run that is
+ *                       still repeatable with the run printed by Record
+ *   Record (os)         "RngSeed=<seed> RngRun=<run>", for the results
+ *
+ * sweep.py follows the same rules (--seed, --independent).
+ */
+
+#ifndef SEED_PLAN_H
+#define SEED_PLAN_H
+
+#include "ns3/core-module.h"
+
+#include <fstream>
+#include <ostream>
+
+namespace ns3 {
+
+class SeedPlan
+{
+public:
+  // MRG32k3a seeds must be below the smaller modulus, m2
+  static const uint32_t MAX_SEED = 4294944442u;
+
+  static void Apply (uint32_t seed, uint64_t run)
+  {
+    NS_ABORT_MSG_UNLESS (seed > 0 && seed <= MAX_SEED, "RngSeed " << seed << " out of 1.." << MAX_SEED);
+    RngSeedManager::SetSeed (seed);
+    RngSeedManager::SetRun (run);
+  }
+
+  /*
+   * Run of replication 'replication' (from 0) of grid point 'point' (from
+   * 0) when each point has 'replications' of them, counting from
+   * 'firstRun'.
+   */
+  static uint64_t Run (uint64_t firstRun, uint32_t point, uint32_t replications, uint32_t replication, bool common)
+  {
+    NS_ABORT_MSG_UNLESS (replication < replications, "Replication " << replication << " of " << replications);
+    return firstRun + replication + (common ? 0 : static_cast<uint64_t> (point) * replications);
+  }
+
+  // A random 48-bit run, far below the 2^51 substreams of a stream.
+  static uint64_t Fresh (void)
+  {
+    std::ifstream urandom ("/dev/urandom", std::ios::binary);
+    NS_ABORT_MSG_UNLESS (urandom.is_open (), "Can't open /dev/urandom");
+    unsigned char b[6];
+    urandom.read (reinterpret_cast<char *> (b), sizeof (b));
+    NS_ABORT_MSG_UNLESS (urandom.gcount () == sizeof (b), "Short read from /dev/urandom");
+    uint64_t run = 0;
+    for (uint32_t i = 0; i < sizeof (b); ++i)
+      {
+        run = (run << 8) | b[i];
+      }
+    return run > 0 ? run : 1;
+  }
+
+  static void Record (std::ostream &os)
+  {
+    os << "RngSeed=" << RngSeedManager::GetSeed () << " RngRun=" << RngSeedManager::GetRun ();
+  }
+};
+
+} // namespace ns3
+
+#endif /* SEED_PLAN_H */
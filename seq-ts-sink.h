@@ -0,0 +1,348 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Sink application accounting loss by sequence number.
+ *
+ * Inferring loss from packet UIDs only works while nothing else creates a
+ * packet between two sends, and not at all with several senders.  The
+ * senders here prepend a SeqTsHeader (BatchTrafficGenerator::SetSeqTs), so
+ * SeqTsSink reads the sequence number and send time of each packet and
+ * keeps, per source address:
+ *
+ *   received   distinct sequence numbers received
+ *   duplicates sequence numbers received again
+ *   reordered  packets that arrived after a higher sequence number
+ *   late       packets older than the window (counted, not classified)
+ *   lost       sequence numbers missing, confirmed or still in the window
+ *   bursts     runs of consecutive confirmed losses, and the longest one
+ *   delay      DelayStats (flow-delay-estimator.h) over the SeqTs send time
+ *
+ * A ring bitmap of the last WINDOW sequence numbers tells duplicates from
+ * late arrivals.  A sequence number is confirmed lost when it leaves the
+ * window unset, so every packet costs a few bit operations; a gap longer
+ * than the window is accounted as one run without walking it.
+ *
+ * Trace sources:
+ *   Rx       (Ptr<const Packet>, const Address &from), as PacketSink
+ *   RxStats  (Ptr<const Packet>, const Address &from, const SeqTsFlowStats &)
+ *            after the statistics of the source were updated
+ *
+ * Usage:
+ *   Ptr<SeqTsSink> sink = CreateObject<SeqTsSink> ();
+ *   sink->SetAttribute ("Local", AddressValue (InetSocketAddress (Ipv4Address::GetAny (), 80)));
+ *   node->AddApplication (sink);
+ *   ...
+ *   sink->Print (std::cout);
+ */
+
+#ifndef SEQ_TS_SINK_H
+#define SEQ_TS_SINK_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/seq-ts-header.h"
+
+#include "flow-delay-estimator.h"
+
+#include <algorithm>
+#include <ostream>
+#include <map>
+
+namespace ns3 {
+
+struct SeqTsFlowStats
+{
+  // sequence numbers tracked behind the highest one seen
+  static const uint32_t WINDOW = 1024;
+  static const uint32_t WORDS = WINDOW / 64;
+
+  SeqTsFlowStats ()
+    : next (0),
+      received (0),
+      duplicates (0),
+      reordered (0),
+      late (0),
+      lost (0),
+      bursts (0),
+      maxBurst (0),
+      burst (0)
+  {
+    std::fill (window, window + WORDS, 0);
+  }
+
+  // Lost so far: confirmed, plus the holes still inside the window.
+  uint64_t GetLost (void) const
+  {
+    uint32_t tracked = std::min<uint64_t> (next, WINDOW);
+    uint32_t set = 0;
+    for (uint32_t w = 0; w < WORDS; ++w)
+      {
+        for (uint64_t bits = window[w]; bits != 0; bits &= bits - 1)
+          {
+            set++;
+          }
+      }
+    return lost + tracked - set;
+  }
+
+  uint64_t next;            // highest sequence number seen + 1
+  uint64_t window[WORDS];   // bit (seq % WINDOW) set if seq in [next - WINDOW, next) arrived
+  uint64_t received;
+  uint64_t duplicates;
+  uint64_t reordered;
+  uint64_t late;
+  uint64_t lost;            // confirmed, i.e. left the window unset
+  uint64_t bursts;
+  uint64_t maxBurst;
+  uint64_t burst;           // length of the loss run in progress
+  DelayStats delay;
+};
+
+class SeqTsSink : public Application
+{
+public:
+  typedef std::map<Address, SeqTsFlowStats>::const_iterator Iterator;
+
+  typedef void (* RxStatsCallback)(Ptr<const Packet> packet, const Address &from,
+                                   const SeqTsFlowStats &stats);
+
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::SeqTsSink")
+      .SetParent<Application> ()
+      .AddConstructor<SeqTsSink> ()
+      .AddAttribute ("Local",
+                     "The address on which to bind the socket.",
+                     AddressValue (),
+                     MakeAddressAccessor (&SeqTsSink::m_local),
+                     MakeAddressChecker ())
+      .AddAttribute ("Protocol",
+                     "The type id of the socket factory to use.",
+                     TypeIdValue (UdpSocketFactory::GetTypeId ()),
+                     MakeTypeIdAccessor (&SeqTsSink::m_tid),
+                     MakeTypeIdChecker ())
+      .AddTraceSource ("Rx",
+                       "A packet has been received.",
+                       MakeTraceSourceAccessor (&SeqTsSink::m_rxTrace),
+                       "ns3::Packet::AddressTracedCallback")
+      .AddTraceSource ("RxStats",
+                       "A packet has been accounted in the statistics of its source.",
+                       MakeTraceSourceAccessor (&SeqTsSink::m_rxStatsTrace),
+                       "ns3::SeqTsSink::RxStatsCallback")
+    ;
+    return tid;
+  }
+
+  SeqTsSink ()
+  {
+  }
+
+  virtual ~SeqTsSink ()
+  {
+  }
+
+  const SeqTsFlowStats *Find (const Address &from) const
+  {
+    Iterator it = m_flows.find (from);
+    return it == m_flows.end () ? 0 : &it->second;
+  }
+
+  Iterator Begin (void) const
+  {
+    return m_flows.begin ();
+  }
+
+  Iterator End (void) const
+  {
+    return m_flows.end ();
+  }
+
+  /*
+   * One line per source, delays in ms:
+   *   <source> <received> <lost> <duplicates> <reordered> <late> <bursts>
+   *   <maxBurst> <meanDelay> <jitter> <p99Delay>
+   */
+  void Print (std::ostream &os) const
+  {
+    os << "# source received lost duplicates reordered late bursts maxBurst"
+       << " meanDelayMs jitterMs p99DelayMs\n";
+    for (Iterator it = m_flows.begin (); it != m_flows.end (); ++it)
+      {
+        const SeqTsFlowStats &s = it->second;
+        if (InetSocketAddress::IsMatchingType (it->first))
+          {
+            InetSocketAddress a = InetSocketAddress::ConvertFrom (it->first);
+            os << a.GetIpv4 () << ":" << a.GetPort ();
+          }
+        else
+          {
+            os << it->first;
+          }
+        os << " " << s.received << " " << s.GetLost () << " " << s.duplicates
+           << " " << s.reordered << " " << s.late
+           << " " << s.bursts << " " << std::max (s.maxBurst, s.burst)
+           << " " << s.delay.mean * 1000 << " " << s.delay.GetJitter () * 1000
+           << " " << s.delay.p99.Get () * 1000 << "\n";
+      }
+    os.flush ();
+  }
+
+protected:
+  virtual void DoDispose (void)
+  {
+    m_socket = 0;
+    Application::DoDispose ();
+  }
+
+private:
+  virtual void StartApplication (void)
+  {
+    if (m_socket == 0)
+      {
+        m_socket = Socket::CreateSocket (GetNode (), m_tid);
+        m_socket->Bind (m_local);
+      }
+    m_socket->SetRecvCallback (MakeCallback (&SeqTsSink::HandleRead, this));
+  }
+
+  virtual void StopApplication (void)
+  {
+    if (m_socket != 0)
+      {
+        m_socket->Close ();
+        m_socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
+      }
+  }
+
+  void HandleRead (Ptr<Socket> socket)
+  {
+    Ptr<Packet> packet;
+    Address from;
+    while ((packet = socket->RecvFrom (from)))
+      {
+        m_rxTrace (packet, from);
+        SeqTsHeader seqTs;
+        if (packet->GetSize () < seqTs.GetSerializedSize ())
+          {
+            continue;
+          }
+        packet->PeekHeader (seqTs);
+        SeqTsFlowStats &s = m_flows[from];
+        if (Account (s, seqTs.GetSeq ()))
+          {
+            s.delay.Add ((Simulator::Now () - seqTs.GetTs ()).GetSeconds ());
+          }
+        m_rxStatsTrace (packet, from, s);
+      }
+  }
+
+  // Account sequence number 'seq'; false for duplicates and late packets.
+  static bool Account (SeqTsFlowStats &s, uint64_t seq)
+  {
+    if (seq >= s.next)
+      {
+        Advance (s, seq + 1);
+        Set (s, seq);
+        s.received++;
+        return true;
+      }
+    if (s.next - seq > SeqTsFlowStats::WINDOW)
+      {
+        s.late++;
+        return false;
+      }
+    if (IsSet (s, seq))
+      {
+        s.duplicates++;
+        return false;
+      }
+    Set (s, seq);
+    s.reordered++;
+    s.received++;
+    return true;
+  }
+
+  // Move the window to end at 'next', confirming what leaves it.
+  static void Advance (SeqTsFlowStats &s, uint64_t next)
+  {
+    const uint64_t window = SeqTsFlowStats::WINDOW;
+    uint64_t shift = next - s.next;
+    uint64_t steps = std::min (shift, window);
+    for (uint64_t seq = s.next; seq < s.next + steps; ++seq)
+      {
+        // seq - WINDOW leaves as seq enters the same bit
+        if (seq >= window)
+          {
+            Leave (s, IsSet (s, seq));
+          }
+        Clear (s, seq);
+      }
+    if (shift > window)
+      {
+        // [old next, next - WINDOW) never arrived and leaves at once
+        s.lost += shift - window;
+        s.burst += shift - window;
+      }
+    s.next = next;
+  }
+
+  static void Leave (SeqTsFlowStats &s, bool arrived)
+  {
+    if (!arrived)
+      {
+        s.lost++;
+        s.burst++;
+      }
+    else if (s.burst > 0)
+      {
+        s.bursts++;
+        s.maxBurst = std::max (s.maxBurst, s.burst);
+        s.burst = 0;
+      }
+  }
+
+  static bool IsSet (const SeqTsFlowStats &s, uint64_t seq)
+  {
+    uint32_t bit = seq % SeqTsFlowStats::WINDOW;
+    return (s.window[bit / 64] >> (bit % 64)) & 1;
+  }
+
+  static void Set (SeqTsFlowStats &s, uint64_t seq)
+  {
+    uint32_t bit = seq % SeqTsFlowStats::WINDOW;
+    s.window[bit / 64] |= uint64_t (1) << (bit % 64);
+  }
+
+  static void Clear (SeqTsFlowStats &s, uint64_t seq)
+  {
+    uint32_t bit = seq % SeqTsFlowStats::WINDOW;
+    s.window[bit / 64] &= ~(uint64_t (1) << (bit % 64));
+  }
+
+  Address m_local;
+  TypeId m_tid;
+  Ptr<Socket> m_socket;
+  std::map<Address, SeqTsFlowStats> m_flows;
+  TracedCallback<Ptr<const Packet>, const Address &> m_rxTrace;
+  TracedCallback<Ptr<const Packet>, const Address &, const SeqTsFlowStats &> m_rxStatsTrace;
+};
+
+} // namespace ns3
+
+#endif /* SEQ_TS_SINK_H */
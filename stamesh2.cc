@@ -15,6 +15,8 @@
 #include <sstream>
 #include <fstream>
 
+#include "trace-binder.h"
+
 /*
  * The topology is displayed as following
  * Nodes in rectangle are mesh nodes
@@ -38,20 +40,20 @@
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("MeshScript");
-void Sta0DevTxTrace(std::string context, Ptr<const Packet> p)
+void Sta0DevTxTrace(TraceId id, Ptr<const Packet> p)
 {
     std::cout<<Simulator::Now().As(Time::S)<<std::endl;
-    std::cout<<context<<", TX p:"<<*p<<std::endl;
+    std::cout<<id<<", TX p:"<<*p<<std::endl;
 }
 
-void Ap0DevRxTrace(std::string context, Ptr<const Packet> p)
+void Ap0DevRxTrace(TraceId id, Ptr<const Packet> p)
 {
-    std::cout<< context <<", RX p: "<< *p <<std::endl;
+    std::cout<< id <<", RX p: "<< *p <<std::endl;
 }
 
-void Mesh0DevRxTrace(std::string context, Ptr<const Packet> p)
+void Mesh0DevRxTrace(TraceId id, Ptr<const Packet> p)
 {
-    std::cout<<context<<", RX p: "<< *p <<std::endl;
+    std::cout<<id<<", RX p: "<< *p <<std::endl;
 }
 
 int main(int argc, char* argv[])
@@ -278,7 +280,8 @@ int main(int argc, char* argv[])
             }
         }
     }
-    Config::Connect("/NodeList/9/DeviceList/*/$ns3::WifiNetDevice/Mac/$ns3::StaWifiMac/MacTx", MakeCallback(&Sta0DevTxTrace));
+    TraceBinder binder;
+    binder.ConnectWithId(TraceBinder::DevicesOf(NodeList::GetNode(9)), TraceBinder::WIFI_MAC, "MacTx", &Sta0DevTxTrace);
 
     UdpEchoServerHelper echoServer(9);
     ApplicationContainer serverApp = echoServer.Install(staNC.Get(1));
@@ -302,8 +305,10 @@ int main(int argc, char* argv[])
         anim.UpdateNodeSize(meshNC.Get(i)->GetId(), nodeWidth, nodeHeight);
     }
 
-    Config::Connect("/NodeList/0/DeviceList/1/Mac/MacRx", MakeCallback(&Mesh0DevRxTrace));
-    Config::Connect("/NodeList/0/DeviceList/1/Mac/MacRx", MakeCallback(&Ap0DevRxTrace));
+    // both sinks share the one resolved WifiMac of node 0 device 1
+    NetDeviceContainer mesh0Dev(NodeList::GetNode(0)->GetDevice(1));
+    binder.ConnectWithId(mesh0Dev, TraceBinder::WIFI_MAC, "MacRx", &Mesh0DevRxTrace);
+    binder.ConnectWithId(mesh0Dev, TraceBinder::WIFI_MAC, "MacRx", &Ap0DevRxTrace);
 
     Simulator::Stop(Seconds(totalTime));
     Simulator::Run();
@@ -6,12 +6,16 @@
 #include "ns3/mesh-module.h"
 #include "ns3/mobility-module.h"
 #include "ns3/mesh-helper.h"
-#include "ns3/netanim-module.h"
 #include "ns3/bridge-helper.h"
 #include "ns3/ipv4-static-routing-helper.h"
 #include "ns3/ipv4-routing-table-entry.h"
 #include "ns3/config-store.h"
 
+#include "mac-trace-counter.h"
+#include "cached-propagation.h"
+#include "binary-trace.h"
+#include "anim-recorder.h"
+
 #include <iostream>
 #include <sstream>
 #include <fstream>
@@ -51,11 +55,6 @@ void Sta0DevTxTrace1(Ptr<const Packet> p)
 }
 
 
-void Ap0DevRxTrace(std::string context, Ptr<const Packet> p)
-{
-    std::cout<< context <<", RX p: "<< *p <<std::endl;
-}
-
 void Mesh0DevRxTrace(std::string context, Ptr<const Packet> p)
 {
     std::cout<<context<<", RX p: "<< *p <<std::endl;
@@ -72,6 +71,7 @@ int main(int argc, char* argv[])
     uint32_t nIntf    = 1;
     bool     pcap     = true;
     bool     log      = true;
+    bool     cachePropagation = false;
     double   randomStart = 0.1;
     uint16_t staNum   = 2;// numbers of station nodes
     double   nodeWidth = 5.0;
@@ -88,6 +88,7 @@ int main(int argc, char* argv[])
     cmd.AddValue("intfN","Number of radio interfaces used by each mesh point.[0.001s]", nIntf);
     cmd.AddValue("pcap", "Enable pcap trace on interfaces.[true]", pcap);
     cmd.AddValue("log",  "Enable log info when running", log);
+    cmd.AddValue("cachePropagation", "Cache loss and delay per node pair.[false]", cachePropagation);
 
     GlobalValue::Bind ("ChecksumEnabled", BooleanValue(true));
 
@@ -101,7 +102,20 @@ int main(int argc, char* argv[])
 
     YansWifiPhyHelper phy = YansWifiPhyHelper::Default();
     YansWifiChannelHelper channel = YansWifiChannelHelper::Default();
-    phy.SetChannel (channel.Create());
+    Ptr<YansWifiChannel> yansChannel = channel.Create();
+    // all nodes are static: the default log-distance loss and constant
+    // speed delay can be computed once per node pair
+    Ptr<CachedPropagationLossModel> cachedLoss;
+    Ptr<CachedPropagationDelayModel> cachedDelay;
+    if(cachePropagation){
+        cachedLoss = CreateObject<CachedPropagationLossModel> ();
+        cachedLoss->SetModel (CreateObject<LogDistancePropagationLossModel> ());
+        yansChannel->SetPropagationLossModel (cachedLoss);
+        cachedDelay = CreateObject<CachedPropagationDelayModel> ();
+        cachedDelay->SetModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+        yansChannel->SetPropagationDelayModel (cachedDelay);
+    }
+    phy.SetChannel (yansChannel);
 
     MeshHelper mesh = MeshHelper::Default();
     std::string stack = "ns3::Dot11sStack";
@@ -185,9 +199,20 @@ int main(int argc, char* argv[])
     positionAlloc->Add(Vector (rowNodes*distance, (colNodes+1)*distance, 0.0));
     mobility.SetPositionAllocator(positionAlloc);
     mobility.Install(bridgeNC);
+    if(cachePropagation){
+        NodeContainer allNC (meshNC, staNC, bridgeNC);
+        cachedLoss->Precompute(allNC);
+        cachedDelay->Precompute(allNC);
+    }
 
-   if(pcap)
-        phy.EnablePcapAll(std::string("pcap/stameshecho"));
+    // binary PHY trace of every wifi device, written off the event loop;
+    // "btrace.py pcap pcap/stameshecho.btr.gz pcap/stameshecho" gives the
+    // per-device pcap files
+    BinaryTraceWriter binaryTrace;
+    if(pcap){
+        binaryTrace.Open("pcap/stameshecho.btr.gz");
+        binaryTrace.EnableWifiAll();
+    }
 
     InternetStackHelper istack;
     istack.Install(meshNC);
@@ -318,7 +343,8 @@ int main(int argc, char* argv[])
     clientApp.Start(Seconds(2.0));
     clientApp.Stop(Seconds(totalTime));
 
-    AnimationInterface anim("xml/stameshecho.xml");
+    // python scratch/anim2xml.py xml/stameshecho.anim xml/stameshecho.xml for NetAnim
+    AnimRecorder anim("xml/stameshecho.anim");
     anim.UpdateNodeColor(staNC.Get(0), 0, 255, 0);
     anim.UpdateNodeSize (staNC.Get(0)->GetId(), nodeWidth, nodeHeight);
     anim.UpdateNodeColor(staNC.Get(1), 255, 0, 0);
@@ -336,10 +362,14 @@ int main(int argc, char* argv[])
 
 
     //Config::Connect("/NodeList/0/DeviceList/1/Mac/MacRx", MakeCallback(&Mesh0DevRxTrace));
-    Config::Connect("/NodeList/0/DeviceList/1/Mac/MacRx", MakeCallback(&Ap0DevRxTrace));
+    // Count ap0's MAC events instead of printing every received frame
+    MacTraceCounter macCounters;
+    macCounters.Install(NodeList::GetNode(0)->GetDevice(1));
 
     Simulator::Stop(Seconds(totalTime));
     Simulator::Run();
+    binaryTrace.Close();
+    macCounters.Print(std::cout);
     Simulator::Destroy();
 
     return 0;
@@ -0,0 +1,221 @@
+#!/usr/bin/env python
+#
+# Parallel parameter sweep for the scratch scenarios.
+#
+# Runs every point of a parameter grid for a range of RngRun values, one
+# process per replication, on all cores.  Each run writes its FlowMonitor
+# summary with --summary (see flow-summary.h); the per-run results and a
+# table with the mean and 95% confidence interval of each metric over the
+# replications are written as CSV.
+#
+# Run from the ns-3 top-level directory after building, e.g.
+#
+#   ./waf build
+#   python scratch/sweep.py --program=adhoc3 --runs=1-10 \
+#       --grid numNodes=27,49 phyMode=ErpOfdmRate6Mbps packetSize=512,1024 \
+#              interval=0.1 rtsCtsThreshold=2200,500
+#
+# A wireless scenario cannot be split across cores within one run: the
+# distributed simulator only carries point-to-point links between ranks,
+# and every node of a grid shares one WifiChannel.  Large grids are
+# therefore parallelised over replications, one run per core, e.g. on a
+# 32-core host:
+#
+#   python scratch/sweep.py --program=adhoc3 --runs=1-32 \
+#       --grid numNodes=500 gridWidth=0 --arg=--numPackets=200
+#
+# adhoc3 can also fork its replications itself after building the
+# topology once (--replications=N --workers=K, see replication-fork.h);
+# --summary then gets the rows of every run with a leading run column.
+#
+# All runs share one master seed (--seed, RngSeed) and differ by RngRun,
+# which keeps their random numbers on disjoint MRG32k3a substreams (see
+# seed-plan.h).  By default every grid point uses the same runs, so the
+# points are compared under common random numbers; with --independent each
+# (point, replication) gets its own run instead.  RngSeed and RngRun are
+# recorded with every result, so any run can be repeated on its own.
+#
+# Scenario files (see scenario-loader.h) are swept without compiling a
+# program per variant: the grid sets their variables.
+#
+#   python scratch/sweep.py --program=scenario --arg=--scenario=scratch/adhoc-grid.scn \
+#       --grid numNodes=25,49 interval=0.1,0.05
+#
+# The program binary is run directly (build/scratch/...) so that parallel
+# jobs do not fight over the waf lock.  Each run gets its own temporary
+# directory for its summary and other output files, removed once the
+# summary is read.  Pass --arg=... for fixed options; --tracing=0 is
+# passed by default.
+#
+
+from __future__ import print_function
+
+import argparse
+import csv
+import glob
+import itertools
+import math
+import multiprocessing
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+# two-sided 95% Student t quantiles, by degrees of freedom
+T95 = [0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+       2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+       2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045,
+       2.042]
+
+METRICS = ["throughputKbps", "deliveryRatio", "meanDelayMs", "meanJitterMs"]
+
+
+def find_binary(program):
+    name = os.path.basename(program)
+    candidates = glob.glob(os.path.join("build", "scratch", name)) + \
+        glob.glob(os.path.join("build", "scratch", "ns3*-" + name + "-*"))
+    candidates = [c for c in candidates if os.access(c, os.X_OK) and not os.path.isdir(c)]
+    if not candidates:
+        sys.exit("no binary for {0} under build/scratch; run ./waf build first".format(name))
+    return candidates[0]
+
+
+def parse_runs(text):
+    runs = []
+    for part in text.split(","):
+        if "-" in part:
+            lo, hi = part.split("-")
+            runs.extend(range(int(lo), int(hi) + 1))
+        else:
+            runs.append(int(part))
+    return runs
+
+
+def parse_grid(items):
+    names = []
+    values = []
+    for item in items:
+        name, _, vals = item.partition("=")
+        names.append(name)
+        values.append(vals.split(","))
+    return names, values
+
+
+def run_one(job):
+    binary, args, params, seed, run, port = job
+    # the scripts write their other files next to the summary (see
+    # FlowSummary::OutputPrefix); the directory goes with the run
+    workdir = tempfile.mkdtemp(prefix="sweep-")
+    summary = os.path.join(workdir, "summary.csv")
+    env = dict(os.environ)
+    env["NS_GLOBAL_VALUE"] = "RngSeed={0};RngRun={1}".format(seed, run)
+    libs = [os.path.abspath("build"), os.path.abspath(os.path.join("build", "lib"))]
+    env["LD_LIBRARY_PATH"] = os.pathsep.join(libs + [env.get("LD_LIBRARY_PATH", "")])
+    cmd = [binary] + args + ["--{0}={1}".format(k, v) for k, v in params] + \
+        ["--summary=" + summary]
+    with open(os.devnull, "w") as devnull:
+        status = subprocess.call(cmd, env=env, stdout=devnull, stderr=devnull)
+    row = dict(params)
+    row["RngSeed"] = seed
+    row["RngRun"] = run
+    row["status"] = status
+    if status == 0:
+        row.update(aggregate(summary, port))
+    shutil.rmtree(workdir, ignore_errors=True)
+    return row
+
+
+def aggregate(summary, port):
+    """Combine the flows sent to 'port' of one run into run-level metrics."""
+    tx = rx = rxBytes = 0
+    duration = delay = jitter = 0.0
+    with open(summary) as f:
+        for flow in csv.DictReader(f):
+            if int(flow["dstPort"]) != port:
+                continue
+            tx += int(flow["txPackets"])
+            rx += int(flow["rxPackets"])
+            rxBytes += int(flow["rxBytes"])
+            duration = max(duration, float(flow["durationS"]))
+            delay += float(flow["meanDelayMs"]) * int(flow["rxPackets"])
+            jitter += float(flow["meanJitterMs"]) * int(flow["rxPackets"])
+    return {
+        "throughputKbps": rxBytes * 8.0 / duration / 1024 if duration > 0 else 0.0,
+        "deliveryRatio": float(rx) / tx if tx > 0 else 0.0,
+        "meanDelayMs": delay / rx if rx > 0 else 0.0,
+        "meanJitterMs": jitter / rx if rx > 0 else 0.0,
+    }
+
+
+def mean_ci(samples):
+    n = len(samples)
+    if n == 0:
+        return 0.0, 0.0
+    mean = sum(samples) / n
+    if n < 2:
+        return mean, 0.0
+    var = sum((x - mean) ** 2 for x in samples) / (n - 1)
+    t = T95[n - 1] if n - 1 < len(T95) else 1.960
+    return mean, t * math.sqrt(var / n)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--program", required=True, help="scratch program, e.g. adhoc3")
+    parser.add_argument("--grid", nargs="+", default=[], help="name=v1,v2,... per parameter")
+    parser.add_argument("--runs", default="1-10", help="RngRun values, e.g. 1-10 or 1,4,7")
+    parser.add_argument("--seed", type=int, default=1, help="RngSeed shared by every run")
+    parser.add_argument("--independent", action="store_true",
+                        help="give each grid point its own runs instead of common random numbers")
+    parser.add_argument("--arg", action="append", default=["--tracing=0"], help="fixed program option")
+    parser.add_argument("--port", type=int, default=80, help="destination port of the measured flows")
+    parser.add_argument("--jobs", type=int, default=multiprocessing.cpu_count())
+    parser.add_argument("--out", default="sweep", help="prefix of the result files")
+    opts = parser.parse_args()
+    if not 0 < opts.seed <= 4294944442:
+        sys.exit("--seed must be in 1..4294944442")
+
+    binary = find_binary(opts.program)
+    names, values = parse_grid(opts.grid)
+    points = [list(zip(names, combo)) for combo in itertools.product(*values)]
+    runs = parse_runs(opts.runs)
+    # with --independent, point i uses the runs shifted past those of points 0..i-1
+    span = max(runs) - min(runs) + 1 if opts.independent else 0
+    jobs = [(binary, opts.arg, point, opts.seed, run + i * span, opts.port)
+            for i, point in enumerate(points) for run in runs]
+
+    print("{0} points x {1} runs on {2} cores".format(len(points), len(jobs) // max(len(points), 1), opts.jobs))
+    pool = multiprocessing.Pool(opts.jobs)
+    rows = []
+    for row in pool.imap_unordered(run_one, jobs):
+        rows.append(row)
+        if row["status"] != 0:
+            print("run failed ({0}): {1}".format(row["status"], row), file=sys.stderr)
+    pool.close()
+    pool.join()
+
+    with open(opts.out + "-runs.csv", "w") as f:
+        writer = csv.DictWriter(f, names + ["RngSeed", "RngRun", "status"] + METRICS, extrasaction="ignore")
+        writer.writeheader()
+        for row in sorted(rows, key=lambda r: ([r[n] for n in names], r["RngRun"])):
+            writer.writerow(row)
+
+    with open(opts.out + ".csv", "w") as f:
+        header = names + ["runs"]
+        for m in METRICS:
+            header += [m, m + "Ci95"]
+        writer = csv.writer(f)
+        writer.writerow(header)
+        for point in points:
+            ok = [r for r in rows if r["status"] == 0 and all(r[n] == v for n, v in point)]
+            line = [v for _, v in point] + [len(ok)]
+            for m in METRICS:
+                line += list(mean_ci([r[m] for r in ok]))
+            writer.writerow(line)
+
+    print("wrote {0}.csv and {0}-runs.csv".format(opts.out))
+
+
+if __name__ == "__main__":
+    main()
@@ -33,6 +33,8 @@
 
 #include <iostream>
 
+#include "trace-binder.h"
+
 // Default Network Topology
 //
 // Number of wifi or csma nodes can be increased up to 250
@@ -202,10 +204,9 @@ main (int argc, char *argv[])
       csma.EnablePcap ("third", csmaDevices.Get (0), true);
     }
   
-  std::ostringstream oss;
-  oss << "/NodeList/" << wifiStaNodes.Get(nWifi - 1)->GetId()<<
-         "/$ns3::MobilityModel/CourseChange";
-  Config::Connect(oss.str(), MakeCallback(&CourseChange));
+  TraceBinder binder;
+  binder.ConnectNodes<MobilityModel> (NodeContainer (wifiStaNodes.Get (nWifi - 1)), "CourseChange",
+                                      MakeCallback (&CourseChange));
 
   Simulator::Run ();
   Simulator::Destroy ();
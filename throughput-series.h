@@ -0,0 +1,286 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Append-only per-flow throughput time series.
+ *
+ * The periodic monitors used to add points to a Gnuplot2dDataset passed by
+ * value, so every tick copied the whole point list and the points never
+ * reached the dataset plotted by main.  ThroughputSeries is shared by
+ * pointer instead: Sample() records (flowId, time, rxBytes, rxPackets)
+ * when the flow's counters moved, and at the first and last sample of a
+ * run of unchanged ones, so that an idle period reads as 0 Mbps from its
+ * start to its end instead of being averaged into the next interval.
+ * Records are buffered into fixed-size blocks that are flushed to a
+ * binary file column by column:
+ *
+ *   "TPS1"
+ *   block: uint32 n, n x uint32 flowId, n x int64 time-ns,
+ *          n x uint64 rxBytes, n x uint32 rxPackets
+ *
+ * Values are written in host byte order.  Memory use is bounded by one
+ * block plus one entry per flow, whatever the simulated duration.  Once
+ * the run is over, ExportGnuplot() and ExportCsv() read the file back and
+ * turn consecutive samples of each flow into interval throughput.
+ */
+
+#ifndef THROUGHPUT_SERIES_H
+#define THROUGHPUT_SERIES_H
+
+#include "ns3/core-module.h"
+#include "ns3/flow-monitor-module.h"
+#include "ns3/gnuplot.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace ns3 {
+
+class ThroughputSeries
+{
+public:
+  ThroughputSeries ()
+    : m_blockSize (4096)
+  {
+  }
+
+  ~ThroughputSeries ()
+  {
+    Close ();
+  }
+
+  void Open (std::string fileName)
+  {
+    Close ();
+    m_fileName = fileName;
+    m_os.open (fileName.c_str (), std::ios::out | std::ios::trunc | std::ios::binary);
+    NS_ABORT_MSG_UNLESS (m_os.is_open (), "Can't open " << fileName);
+    m_os.write ("TPS1", 4);
+    m_last.clear ();
+  }
+
+  void Close (void)
+  {
+    if (m_os.is_open ())
+      {
+        // flows idle at the end: their zero runs until the last sample
+        for (std::map<FlowId, Last>::iterator it = m_last.begin (); it != m_last.end (); ++it)
+          {
+            EndIdle (it->first, it->second);
+          }
+        Flush ();
+        m_os.close ();
+      }
+  }
+
+  /*
+   * Record the counters of one flow at the current time.  If they did not
+   * move since the previous sample of that flow, only the first sample of
+   * the idle period is stored, and its last one once the flow moves again.
+   */
+  void Sample (FlowId flowId, uint64_t rxBytes, uint32_t rxPackets)
+  {
+    int64_t now = Simulator::Now ().GetNanoSeconds ();
+    std::map<FlowId, Last>::iterator it = m_last.find (flowId);
+    if (it != m_last.end () && it->second.bytes == rxBytes)
+      {
+        Last &last = it->second;
+        if (!last.idle)
+          {
+            Store (flowId, now, rxBytes, rxPackets);
+            last.idle = true;
+            last.stored = now;
+          }
+        last.time = now;
+        return;
+      }
+    if (it != m_last.end ())
+      {
+        EndIdle (flowId, it->second);
+      }
+    Store (flowId, now, rxBytes, rxPackets);
+    Last &last = m_last[flowId];
+    last.bytes = rxBytes;
+    last.packets = rxPackets;
+    last.time = now;
+    last.stored = now;
+    last.idle = false;
+  }
+
+  /*
+   * Add one dataset per flow to 'plot', with the throughput (Mbps) seen
+   * between consecutive samples of that flow.
+   */
+  void ExportGnuplot (Gnuplot &plot, std::string title)
+  {
+    std::map<FlowId, Gnuplot2dDataset> datasets;
+    Series points;
+    Read (points);
+    for (Series::const_iterator it = points.begin (); it != points.end (); ++it)
+      {
+        if (datasets.find (it->flowId) == datasets.end ())
+          {
+            std::ostringstream oss;
+            oss << title << " flow " << it->flowId;
+            datasets[it->flowId].SetTitle (oss.str ());
+            datasets[it->flowId].SetStyle (Gnuplot2dDataset::LINES_POINTS);
+          }
+        datasets[it->flowId].Add (it->time, it->mbps);
+      }
+    for (std::map<FlowId, Gnuplot2dDataset>::const_iterator it = datasets.begin (); it != datasets.end (); ++it)
+      {
+        plot.AddDataset (it->second);
+      }
+  }
+
+  void ExportCsv (std::string fileName)
+  {
+    std::ofstream os (fileName.c_str ());
+    NS_ABORT_MSG_UNLESS (os.is_open (), "Can't open " << fileName);
+    os << "flowId,time,rxBytes,rxPackets,throughputMbps\n";
+    Series points;
+    Read (points);
+    for (Series::const_iterator it = points.begin (); it != points.end (); ++it)
+      {
+        os << it->flowId << "," << it->time << "," << it->bytes << ","
+           << it->packets << "," << it->mbps << "\n";
+      }
+  }
+
+private:
+  struct Point
+  {
+    FlowId flowId;
+    double time;
+    uint64_t bytes;
+    uint32_t packets;
+    double mbps;
+  };
+  typedef std::vector<Point> Series;
+
+  // Previous sample of a flow, and the time of the last one stored.
+  struct Last
+  {
+    uint64_t bytes;
+    uint32_t packets;
+    int64_t time;
+    int64_t stored;
+    bool idle;
+  };
+
+  void Store (FlowId flowId, int64_t time, uint64_t rxBytes, uint32_t rxPackets)
+  {
+    m_flowId.push_back (flowId);
+    m_time.push_back (time);
+    m_bytes.push_back (rxBytes);
+    m_packets.push_back (rxPackets);
+    if (m_flowId.size () >= m_blockSize)
+      {
+        Flush ();
+      }
+  }
+
+  // Store the last unchanged sample of an idle period, if not stored yet.
+  void EndIdle (FlowId flowId, Last &last)
+  {
+    if (last.idle && last.time > last.stored)
+      {
+        Store (flowId, last.time, last.bytes, last.packets);
+        last.stored = last.time;
+      }
+  }
+
+  void Flush (void)
+  {
+    uint32_t n = m_flowId.size ();
+    if (n == 0)
+      {
+        return;
+      }
+    m_os.write (reinterpret_cast<const char *> (&n), sizeof (n));
+    m_os.write (reinterpret_cast<const char *> (&m_flowId[0]), n * sizeof (uint32_t));
+    m_os.write (reinterpret_cast<const char *> (&m_time[0]), n * sizeof (int64_t));
+    m_os.write (reinterpret_cast<const char *> (&m_bytes[0]), n * sizeof (uint64_t));
+    m_os.write (reinterpret_cast<const char *> (&m_packets[0]), n * sizeof (uint32_t));
+    m_os.flush ();
+    m_flowId.clear ();
+    m_time.clear ();
+    m_bytes.clear ();
+    m_packets.clear ();
+  }
+
+  // Read the whole file back, converting byte counters into rates.  The
+  // first sample of a flow has no predecessor and is reported as 0 Mbps.
+  void Read (Series &points)
+  {
+    Close ();
+    std::ifstream is (m_fileName.c_str (), std::ios::in | std::ios::binary);
+    NS_ABORT_MSG_UNLESS (is.is_open (), "Can't open " << m_fileName);
+    char magic[4];
+    is.read (magic, 4);
+    NS_ABORT_MSG_UNLESS (is && std::string (magic, 4) == "TPS1", m_fileName << " is not a throughput series");
+
+    std::map<FlowId, std::pair<int64_t, uint64_t> > previous;
+    uint32_t n;
+    while (is.read (reinterpret_cast<char *> (&n), sizeof (n)))
+      {
+        std::vector<uint32_t> flowId (n);
+        std::vector<int64_t> time (n);
+        std::vector<uint64_t> bytes (n);
+        std::vector<uint32_t> packets (n);
+        is.read (reinterpret_cast<char *> (&flowId[0]), n * sizeof (uint32_t));
+        is.read (reinterpret_cast<char *> (&time[0]), n * sizeof (int64_t));
+        is.read (reinterpret_cast<char *> (&bytes[0]), n * sizeof (uint64_t));
+        is.read (reinterpret_cast<char *> (&packets[0]), n * sizeof (uint32_t));
+        NS_ABORT_MSG_UNLESS (is, m_fileName << " is truncated");
+
+        for (uint32_t k = 0; k < n; ++k)
+          {
+            Point p;
+            p.flowId = flowId[k];
+            p.time = time[k] / 1e9;
+            p.bytes = bytes[k];
+            p.packets = packets[k];
+            p.mbps = 0;
+            std::map<FlowId, std::pair<int64_t, uint64_t> >::iterator prev = previous.find (p.flowId);
+            if (prev != previous.end () && time[k] > prev->second.first)
+              {
+                p.mbps = (bytes[k] - prev->second.second) * 8.0
+                  / ((time[k] - prev->second.first) / 1e9) / 1024 / 1024;
+              }
+            previous[p.flowId] = std::make_pair (time[k], bytes[k]);
+            points.push_back (p);
+          }
+      }
+  }
+
+  uint32_t m_blockSize;
+  std::string m_fileName;
+  std::ofstream m_os;
+  std::map<FlowId, Last> m_last;
+  std::vector<uint32_t> m_flowId;
+  std::vector<int64_t> m_time;
+  std::vector<uint64_t> m_bytes;
+  std::vector<uint32_t> m_packets;
+};
+
+} // namespace ns3
+
+#endif /* THROUGHPUT_SERIES_H */
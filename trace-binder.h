@@ -0,0 +1,425 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Bind trace sources on whole containers without Config paths.
+ *
+ * Config::Connect parses its path and walks the object graph from
+ * /NodeList on every call, and the scripts build those paths with an
+ * ostringstream one node at a time.  TraceBinder goes straight from the
+ * NetDeviceContainer / NodeContainer to the object owning the trace
+ * source (the device, its WifiMac or WifiPhy, or an object aggregated to
+ * the node) and caches it, so attaching many sinks to the same devices
+ * resolves each object once and costs one TraceConnect per sink.
+ *
+ * Connect() hands the callback the same context string Config::Connect
+ * would, built once per object at bind time, so existing
+ * (std::string context, ...) callbacks work unchanged.
+ *
+ * ConnectWithId() is the cheaper mode for per-packet sinks: the callback
+ * takes a TraceId (nodeId, ifIndex) by value as its first argument
+ * instead of the context string.  The id is bound into the callback at
+ * connect time, so an event does not build or copy any string.
+ *
+ * Usage:
+ *   TraceBinder binder;
+ *   binder.Connect (devices, TraceBinder::WIFI_MAC, "MacTxDrop", MakeCallback (&MacTxDrop));
+ *   binder.ConnectNodes<Ipv4L3Protocol> (nodes, "Tx", MakeCallback (&Tx));
+ *
+ *   void MacRx (TraceId id, Ptr<const Packet> p);
+ *   binder.ConnectWithId (devices, TraceBinder::WIFI_MAC, "MacRx", &MacRx);
+ *
+ * TraceSinks<T> is for collectors that keep one struct per traced object
+ * and bind its address into the callbacks.  It stores the structs where
+ * adding more does not move them, and disconnects every callback it made
+ * when it is destroyed, so no source is left calling into freed memory:
+ *
+ *   TraceSinks<Slot> m_slots;
+ *   static void Record (Slot *slot, Ptr<const Packet> p);
+ *   Slot *slot = m_slots.Add (Slot (nodeId));
+ *   m_slots.Connect (mac, "MacTx", &Counter::Record, slot);
+ */
+
+#ifndef TRACE_BINDER_H
+#define TRACE_BINDER_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/wifi-module.h"
+
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <deque>
+#include <vector>
+
+namespace ns3 {
+
+// Where a trace event came from, in place of the Config context string.
+struct TraceId
+{
+  static const uint32_t NO_DEVICE = 0xffffffff; // ifIndex of node-level sources
+
+  TraceId ()
+    : nodeId (0),
+      ifIndex (NO_DEVICE)
+  {
+  }
+
+  TraceId (uint32_t node, uint32_t dev)
+    : nodeId (node),
+      ifIndex (dev)
+  {
+  }
+
+  uint32_t nodeId;
+  uint32_t ifIndex;
+};
+
+inline std::ostream &
+operator << (std::ostream &os, const TraceId &id)
+{
+  os << "node " << id.nodeId;
+  if (id.ifIndex != TraceId::NO_DEVICE)
+    {
+      os << " dev " << id.ifIndex;
+    }
+  return os;
+}
+
+class TraceBinder
+{
+public:
+  // Which object of a device owns the trace source.
+  enum Target
+  {
+    DEVICE,
+    WIFI_MAC,
+    WIFI_PHY
+  };
+
+  TraceBinder ()
+  {
+  }
+
+  // All devices of one node, i.e. /NodeList/<id>/DeviceList/*
+  static NetDeviceContainer DevicesOf (Ptr<Node> node)
+  {
+    NetDeviceContainer devices;
+    for (uint32_t i = 0; i < node->GetNDevices (); ++i)
+      {
+        devices.Add (node->GetDevice (i));
+      }
+    return devices;
+  }
+
+  /*
+   * Connect 'cb' to 'source' on the 'target' of every device.  Returns the
+   * number of devices that have such a source.
+   */
+  uint32_t Connect (NetDeviceContainer devices, Target target, std::string source, const CallbackBase &cb)
+  {
+    return ConnectDevices (devices, target, source, cb, true);
+  }
+
+  uint32_t ConnectWithoutContext (NetDeviceContainer devices, Target target, std::string source,
+                                  const CallbackBase &cb)
+  {
+    return ConnectDevices (devices, target, source, cb, false);
+  }
+
+  /*
+   * Connect 'cb' to 'source' on the object of type T aggregated to every
+   * node, e.g. ConnectNodes<Ipv4L3Protocol> (nodes, "Tx", cb).
+   */
+  template <typename T>
+  uint32_t ConnectNodes (NodeContainer nodes, std::string source, const CallbackBase &cb)
+  {
+    return ConnectAggregated (nodes, T::GetTypeId (), source, cb, true);
+  }
+
+  template <typename T>
+  uint32_t ConnectNodesWithoutContext (NodeContainer nodes, std::string source, const CallbackBase &cb)
+  {
+    return ConnectAggregated (nodes, T::GetTypeId (), source, cb, false);
+  }
+
+  /*
+   * Connect 'fn' (TraceId, args...) to 'source' on the 'target' of every
+   * device, or on the object of type T of every node for ConnectNodesWithId.
+   * 'fn' is any function pointer whose first parameter is TraceId; the
+   * source's arguments follow, as many as MakeBoundCallback takes.
+   */
+  template <typename F>
+  uint32_t ConnectWithId (NetDeviceContainer devices, Target target, std::string source, F fn)
+  {
+    uint32_t connected = 0;
+    for (NetDeviceContainer::Iterator i = devices.Begin (); i != devices.End (); ++i)
+      {
+        connected += ConnectId (Resolve (*i, target), source, fn);
+      }
+    return connected;
+  }
+
+  template <typename T, typename F>
+  uint32_t ConnectNodesWithId (NodeContainer nodes, std::string source, F fn)
+  {
+    uint32_t connected = 0;
+    for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); ++i)
+      {
+        connected += ConnectId (Resolve (*i, T::GetTypeId ()), source, fn);
+      }
+    return connected;
+  }
+
+private:
+  struct Resolved
+  {
+    Ptr<Object> object;
+    std::string prefix; // context up to, not including, the source name
+    TraceId id;
+  };
+
+  // (nodeId, ifIndex or NO_DEVICE for node objects, target or TypeId uid)
+  typedef std::pair<std::pair<uint32_t, uint32_t>, uint32_t> Key;
+
+  uint32_t ConnectDevices (NetDeviceContainer devices, Target target, std::string source,
+                           const CallbackBase &cb, bool withContext)
+  {
+    uint32_t connected = 0;
+    for (NetDeviceContainer::Iterator i = devices.Begin (); i != devices.End (); ++i)
+      {
+        const Resolved &r = Resolve (*i, target);
+        if (r.object != 0 && Connect (r, source, cb, withContext))
+          {
+            connected++;
+          }
+      }
+    return connected;
+  }
+
+  uint32_t ConnectAggregated (NodeContainer nodes, TypeId tid, std::string source,
+                              const CallbackBase &cb, bool withContext)
+  {
+    uint32_t connected = 0;
+    for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); ++i)
+      {
+        const Resolved &r = Resolve (*i, tid);
+        if (r.object != 0 && Connect (r, source, cb, withContext))
+          {
+            connected++;
+          }
+      }
+    return connected;
+  }
+
+  bool Connect (const Resolved &r, std::string source, const CallbackBase &cb, bool withContext)
+  {
+    if (withContext)
+      {
+        return r.object->TraceConnect (source, r.prefix + source, cb);
+      }
+    return r.object->TraceConnectWithoutContext (source, cb);
+  }
+
+  // The object's id is bound into the callback, so it is built once here.
+  template <typename F>
+  static bool ConnectId (const Resolved &r, std::string source, F fn)
+  {
+    return r.object != 0 && r.object->TraceConnectWithoutContext (source, MakeBoundCallback (fn, r.id));
+  }
+
+  const Resolved &Resolve (Ptr<NetDevice> device, Target target)
+  {
+    Key key (std::make_pair (device->GetNode ()->GetId (), device->GetIfIndex ()), target);
+    std::map<Key, Resolved>::iterator it = m_cache.find (key);
+    if (it != m_cache.end ())
+      {
+        return it->second;
+      }
+
+    Resolved &r = m_cache[key];
+    r.id = TraceId (key.first.first, key.first.second);
+    std::ostringstream oss;
+    oss << "/NodeList/" << key.first.first << "/DeviceList/" << key.first.second << "/";
+    Ptr<WifiNetDevice> wifi = DynamicCast<WifiNetDevice> (device);
+    switch (target)
+      {
+      case WIFI_MAC:
+        if (wifi != 0)
+          {
+            r.object = wifi->GetMac ();
+            oss << "$ns3::WifiNetDevice/Mac/";
+          }
+        break;
+      case WIFI_PHY:
+        if (wifi != 0)
+          {
+            r.object = wifi->GetPhy ();
+            oss << "$ns3::WifiNetDevice/Phy/";
+          }
+        break;
+      default:
+        r.object = device;
+        break;
+      }
+    r.prefix = oss.str ();
+    return r;
+  }
+
+  const Resolved &Resolve (Ptr<Node> node, TypeId tid)
+  {
+    uint32_t noDevice = TraceId::NO_DEVICE; // make_pair takes references
+    Key key (std::make_pair (node->GetId (), noDevice), tid.GetUid ());
+    std::map<Key, Resolved>::iterator it = m_cache.find (key);
+    if (it != m_cache.end ())
+      {
+        return it->second;
+      }
+
+    Resolved &r = m_cache[key];
+    r.id = TraceId (node->GetId (), TraceId::NO_DEVICE);
+    r.object = node->GetObject<Object> (tid);
+    std::ostringstream oss;
+    oss << "/NodeList/" << node->GetId () << "/$" << tid.GetName () << "/";
+    r.prefix = oss.str ();
+    return r;
+  }
+
+  std::map<Key, Resolved> m_cache;
+};
+
+template <typename T>
+class TraceSinks
+{
+public:
+  typedef typename std::deque<T>::iterator Iterator;
+  typedef typename std::deque<T>::const_iterator ConstIterator;
+
+  TraceSinks ()
+  {
+  }
+
+  ~TraceSinks ()
+  {
+    DisconnectAll ();
+  }
+
+  // Store a copy of 'sink'; the pointer stays valid until Clear ().
+  T *Add (const T &sink)
+  {
+    m_sinks.push_back (sink);
+    return &m_sinks.back ();
+  }
+
+  // Drop the sink added last, which must not have been connected.
+  void RemoveLast (void)
+  {
+    m_sinks.pop_back ();
+  }
+
+  /*
+   * Connect 'source' of 'object', without context, to 'fn' with 'sink'
+   * bound as its first argument.  Returns false if there is no such source.
+   */
+  template <typename F>
+  bool Connect (Ptr<Object> object, std::string source, F fn, T *sink)
+  {
+    Connection c;
+    c.object = object;
+    c.source = source;
+    c.callback = MakeBoundCallback (fn, sink);
+    if (!object->TraceConnectWithoutContext (source, c.callback))
+      {
+        return false;
+      }
+    m_connections.push_back (c);
+    return true;
+  }
+
+  // Disconnect every callback; the sinks themselves are kept.
+  void DisconnectAll (void)
+  {
+    for (typename std::vector<Connection>::iterator c = m_connections.begin (); c != m_connections.end (); ++c)
+      {
+        c->object->TraceDisconnectWithoutContext (c->source, c->callback);
+      }
+    m_connections.clear ();
+  }
+
+  // Disconnect every callback and drop the sinks, e.g. from DoDispose.
+  void Clear (void)
+  {
+    DisconnectAll ();
+    m_sinks.clear ();
+  }
+
+  uint32_t GetN (void) const
+  {
+    return m_sinks.size ();
+  }
+
+  T &Get (uint32_t i)
+  {
+    return m_sinks[i];
+  }
+
+  const T &Get (uint32_t i) const
+  {
+    return m_sinks[i];
+  }
+
+  Iterator Begin (void)
+  {
+    return m_sinks.begin ();
+  }
+
+  Iterator End (void)
+  {
+    return m_sinks.end ();
+  }
+
+  ConstIterator Begin (void) const
+  {
+    return m_sinks.begin ();
+  }
+
+  ConstIterator End (void) const
+  {
+    return m_sinks.end ();
+  }
+
+private:
+  struct Connection
+  {
+    Ptr<Object> object;
+    std::string source;
+    CallbackBase callback;
+  };
+
+  // copies would share the bound pointers
+  TraceSinks (const TraceSinks &);
+  TraceSinks &operator = (const TraceSinks &);
+
+  std::deque<T> m_sinks;
+  std::vector<Connection> m_connections;
+};
+
+} // namespace ns3
+
+#endif /* TRACE_BINDER_H */
@@ -0,0 +1,184 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Save the routes and neighbors of a warmed-up network, and preload them
+ * into later runs.
+ *
+ * ns-3 cannot checkpoint a running simulation: pending events, MAC and
+ * PHY state and protocol timers are not serializable.  What the traffic
+ * needs from the warm-up is a route at every hop and a resolved next hop,
+ * and those can be saved:
+ *
+ *   Save     the OLSR routing table and the live ARP entries of every
+ *            node, to a text file
+ *   Load     each saved route becomes a host route of the node's
+ *            Ipv4StaticRouting, and each ARP entry a permanent one
+ *
+ * In the scripts' list routing OLSR (priority 10) is asked before static
+ * routing (0), so the preloaded routes carry the traffic only while OLSR
+ * has no route of its own, and OLSR takes over as it converges.  OLSR,
+ * the MAC and the RNG streams still start from scratch; replications
+ * differ by their traffic seeds, not by their warm-up.  For an exact copy
+ * of the warmed-up process, fork it (see replication-fork.h).
+ *
+ * The node ids, interface indexes and addresses must be the same in the
+ * saving and loading runs, i.e. the same script and topology.  The
+ * topology must also be static: a preloaded route never expires, and
+ * with moving nodes it would outlive its link and keep attracting the
+ * traffic to a next hop out of reach wherever OLSR has no route yet.
+ * Load therefore aborts if a node has a mobility model other than
+ * ConstantPositionMobilityModel.
+ *
+ * File lines:
+ *   route <node> <dest> <next> <iface> <distance>
+ *   arp <node> <iface> <address> <lladdr>
+ *
+ * Usage:
+ *   Simulator::Schedule (Seconds (31), &WarmState::Save, "warm.txt", c);
+ *   ...
+ *   WarmState::Load ("warm.txt");    // after addresses are assigned
+ */
+
+#ifndef WARM_STATE_H
+#define WARM_STATE_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/olsr-routing-protocol.h"
+
+#include "route-journal.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+class WarmState
+{
+public:
+  static void Save (std::string fileName, NodeContainer nodes)
+  {
+    std::ofstream out (fileName.c_str ());
+    NS_ABORT_MSG_UNLESS (out.is_open (), "Can't open " << fileName);
+    out << "# warm state 1 at " << Simulator::Now ().GetSeconds () << " s" << '\n';
+    uint32_t routes = 0;
+    uint32_t neighbors = 0;
+    for (NodeContainer::Iterator n = nodes.Begin (); n != nodes.End (); ++n)
+      {
+        uint32_t id = (*n)->GetId ();
+        Ptr<olsr::RoutingProtocol> olsr = RouteJournal::FindOlsr (*n);
+        if (olsr != 0)
+          {
+            std::vector<olsr::RoutingTableEntry> entries = olsr->GetRoutingTableEntries ();
+            for (std::vector<olsr::RoutingTableEntry>::const_iterator e = entries.begin (); e != entries.end (); ++e)
+              {
+                out << "route " << id << " " << e->destAddr << " " << e->nextAddr
+                    << " " << e->interface << " " << e->distance << '\n';
+                routes++;
+              }
+          }
+        Ptr<Ipv4L3Protocol> ipv4 = (*n)->GetObject<Ipv4L3Protocol> ();
+        for (uint32_t i = 0; ipv4 != 0 && i < ipv4->GetNInterfaces (); ++i)
+          {
+            Ptr<ArpCache> arp = ipv4->GetInterface (i)->GetArpCache ();
+            if (arp == 0)
+              {
+                continue;
+              }
+            // ArpCache has no iterator; its printout gives the addresses
+            std::ostringstream oss;
+            arp->PrintArpCache (Create<OutputStreamWrapper> (&oss));
+            std::istringstream lines (oss.str ());
+            std::string line;
+            while (std::getline (lines, line))
+              {
+                std::istringstream fields (line);
+                std::string address;
+                fields >> address;
+                ArpCache::Entry *entry = arp->Lookup (Ipv4Address (address.c_str ()));
+                if (entry != 0 && (entry->IsAlive () || entry->IsPermanent ()))
+                  {
+                    out << "arp " << id << " " << i << " " << address << " " << entry->GetMacAddress () << '\n';
+                    neighbors++;
+                  }
+              }
+          }
+      }
+    NS_LOG_UNCOND ("Saved " << routes << " routes and " << neighbors << " neighbors to " << fileName);
+  }
+
+  static void Load (std::string fileName)
+  {
+    for (NodeList::Iterator n = NodeList::Begin (); n != NodeList::End (); ++n)
+      {
+        Ptr<MobilityModel> mobility = (*n)->GetObject<MobilityModel> ();
+        NS_ABORT_MSG_UNLESS (mobility == 0 || DynamicCast<ConstantPositionMobilityModel> (mobility) != 0,
+                             "Warm state needs static nodes, node " << (*n)->GetId () << " has "
+                             << mobility->GetInstanceTypeId ().GetName ());
+      }
+    std::ifstream in (fileName.c_str ());
+    NS_ABORT_MSG_UNLESS (in.is_open (), "Can't open " << fileName);
+    Ipv4StaticRoutingHelper helper;
+    std::string line;
+    while (std::getline (in, line))
+      {
+        std::istringstream fields (line);
+        std::string kind;
+        uint32_t id;
+        if (!(fields >> kind >> id) || kind[0] == '#')
+          {
+            continue;
+          }
+        NS_ABORT_MSG_UNLESS (id < NodeList::GetNNodes (), "Warm state of node " << id << " not in this topology");
+        Ptr<Node> node = NodeList::GetNode (id);
+        Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+        if (kind == "route")
+          {
+            std::string dest, next;
+            uint32_t itf, distance;
+            fields >> dest >> next >> itf >> distance;
+            Ptr<Ipv4StaticRouting> routing = helper.GetStaticRouting (ipv4);
+            NS_ABORT_MSG_UNLESS (routing != 0, "Node " << id << " has no static routing to preload");
+            routing->AddHostRouteTo (Ipv4Address (dest.c_str ()), Ipv4Address (next.c_str ()), itf, distance);
+          }
+        else if (kind == "arp")
+          {
+            uint32_t itf;
+            std::string address;
+            Address mac;
+            fields >> itf >> address >> mac;
+            Ptr<ArpCache> arp = node->GetObject<Ipv4L3Protocol> ()->GetInterface (itf)->GetArpCache ();
+            ArpCache::Entry *entry = arp->Lookup (Ipv4Address (address.c_str ()));
+            if (entry == 0)
+              {
+                entry = arp->Add (Ipv4Address (address.c_str ()));
+              }
+            entry->SetMacAddress (mac);
+            entry->MarkPermanent ();
+          }
+      }
+  }
+};
+
+} // namespace ns3
+
+#endif /* WARM_STATE_H */
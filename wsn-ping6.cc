@@ -48,6 +48,8 @@
 #include "ns3/network-module.h"
 #include "ns3/netanim-module.h"
 
+#include "batch-traffic-generator.h"
+
 
 using namespace ns3;
 
@@ -77,19 +79,6 @@ void RecvPacket(Ptr<Socket> socket) {
     }
 }
 
-static void GenerateTraffic(Ptr<Socket> socket, uint32_t pktSize,
-        Ptr<Node> node, uint32_t pktCount, Time pktInterval) {
-    if (pktCount>0) {
-        NS_LOG_DEBUG("Pkt No."<<pktCount);
-        socket->Send(Create<Packet> (pktSize));
-        Simulator::Schedule(pktInterval,&GenerateTraffic,socket,
-                pktSize,node,--pktCount,pktInterval);
-
-    }
-    else
-        NS_LOG_UNCOND("Socket Finished");
-        socket->Close();
-}
 int main (int argc, char **argv)
 {
   bool verbose = false;
@@ -171,8 +160,10 @@ int main (int argc, char **argv)
       lrWpanHelper.EnablePcap ("masp",nodes.Get(19)->GetId(), 0, true);
       AnimationInterface anim("wsnping6.xml");
 
-      Simulator::Schedule (Seconds (5.0), &GenerateTraffic, source,
-              PpacketSize, nodes.Get(19), numPacket, interPacketInterval);
+      Ptr<BatchTrafficGenerator> traffic = CreateObject<BatchTrafficGenerator> ();
+      traffic->AddSource (source, PpacketSize, numPacket, interPacketInterval);
+      nodes.Get (19)->AddApplication (traffic);
+      traffic->SetStartTime (Seconds (5.0));
       Simulator::Stop(Seconds(30.0));
 
   NS_LOG_INFO ("Run Simulation.");